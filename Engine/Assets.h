@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Surface.h"
+#include "Font.h"
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+// process wide cache of rendering assets
+// each file is loaded once, on first use, and then shared read-only by every
+// map / robot / simulator that draws it; simulation code never touches this,
+// so headless runs load no images at all
+class Assets
+{
+public:
+	static const Surface& GetSurface( const std::string& filename )
+	{
+		return Get( GetCache<Surface>(),filename );
+	}
+	static const Font& GetFont( const std::string& filename )
+	{
+		return Get( GetCache<Font>(),filename );
+	}
+private:
+	template<typename T>
+	struct Cache
+	{
+		std::mutex mutex;
+		// unique_ptr so references stay valid as the map grows
+		std::unordered_map<std::string,std::unique_ptr<const T>> items;
+	};
+private:
+	template<typename T>
+	static Cache<T>& GetCache()
+	{
+		static Cache<T> cache;
+		return cache;
+	}
+	template<typename T>
+	static const T& Get( Cache<T>& cache,const std::string& filename )
+	{
+		std::lock_guard<std::mutex> lock( cache.mutex );
+		auto& pItem = cache.items[filename];
+		if( !pItem )
+		{
+			pItem = std::make_unique<const T>( filename );
+		}
+		return *pItem;
+	}
+};
\ No newline at end of file
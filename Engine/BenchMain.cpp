@@ -0,0 +1,29 @@
+// headless command line runner for the simulation core
+// builds without any windows / d3d dependencies (see ROBOMAZE_HEADLESS)
+// usage: robomaze_bench [ini file] [ai name]  (run from the Engine directory so Maps/ resolves)
+// the ai name overrides the ini 'ai' key, so planners can be compared on the same seeds
+#include "Config.h"
+#include "Evaluator.h"
+#include <iostream>
+#include <exception>
+
+int main( int argc,char* argv[] )
+{
+	try
+	{
+		Config config( argc > 1 ? argv[1] : "sim.ini" );
+		if( argc > 2 )
+		{
+			config.SetAiName( argv[2] );
+		}
+		// results file is written as configured, the text summary is echoed to stdout
+		Evaluator eval( config,&std::cout );
+		eval.Run();
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_bench: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
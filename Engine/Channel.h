@@ -0,0 +1,69 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+// multi producer / multi consumer queue, unbounded unless given a capacity
+// Pop blocks until an item arrives or the channel is closed and drained,
+// Push on a full bounded channel blocks until a Pop makes room
+template<typename T>
+class Channel
+{
+public:
+	// capacity of 0 means unbounded
+	explicit Channel( size_t capacity = 0u )
+		:
+		capacity( capacity )
+	{}
+	Channel( const Channel& ) = delete;
+	Channel& operator=( const Channel& ) = delete;
+	// returns false (and drops the item) once the channel is closed
+	bool Push( T item )
+	{
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			cv_space.wait( lock,[this]() { return capacity == 0u || items.size() < capacity || closed; } );
+			if( closed )
+			{
+				return false;
+			}
+			items.push_back( std::move( item ) );
+		}
+		cv.notify_one();
+		return true;
+	}
+	// returns false once the channel is closed and empty
+	bool Pop( T& item )
+	{
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			cv.wait( lock,[this]() { return !items.empty() || closed; } );
+			if( items.empty() )
+			{
+				return false;
+			}
+			item = std::move( items.front() );
+			items.pop_front();
+		}
+		cv_space.notify_one();
+		return true;
+	}
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			closed = true;
+		}
+		cv.notify_all();
+		cv_space.notify_all();
+	}
+private:
+	size_t capacity;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::condition_variable cv_space;
+	std::deque<T> items;
+	bool closed = false;
+};
\ No newline at end of file
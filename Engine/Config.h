@@ -1,13 +1,19 @@
 #pragma once
 
-#include "ChiliWin.h"
 #include "Direction.h"
 #include <string>
+#include <fstream>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
 #include <cassert>
+#include <cstdint>
 
 class Config
 {
 	friend class Evaluator;
+	friend class GoldenCorpus;
 public:
 	enum class SimulationMode
 	{
@@ -36,7 +42,6 @@ public:
 	explicit Config( const std::string& filename )
 	{
 		using namespace std::string_literals;
-		char buffer[1024];
 		const auto ThrowIfFalse = []( bool pred,const std::string& msg )
 		{
 			if( !pred )
@@ -44,54 +49,121 @@ public:
 				//throw std::runtime_error( "Config load error.\n" + msg );
 			}
 		};
-		// get full path to ini file
-		GetCurrentDirectoryA( sizeof( buffer ),buffer );
-		const std::string full_ini_path = buffer + "\\"s + filename;
+		// ThrowIfFalse is disabled, checks that must hold (values that would otherwise
+		// be silently misread) go through this one
+		const auto Require = []( bool pred,const std::string& msg )
+		{
+			if( !pred )
+			{
+				throw std::runtime_error( "Config load error.\n" + msg );
+			}
+		};
+		// parse ini file into section.key -> value table
+		const auto ini = LoadIni( filename );
+		const auto GetProfileInt = [&ini]( const std::string& section,const std::string& key,int def )
+		{
+			const auto i = ini.find( section + "." + key );
+			if( i == ini.end() )
+			{
+				return def;
+			}
+			try
+			{
+				return std::stoi( i->second );
+			}
+			catch( const std::exception& )
+			{
+				return def;
+			}
+		};
+		const auto GetProfileString = [&ini]( const std::string& section,const std::string& key )
+		{
+			const auto i = ini.find( section + "." + key );
+			return i != ini.end() ? i->second : ""s;
+		};
 		// load sim mode setting
-		sim_mode = (SimulationMode)GetPrivateProfileIntA( "simulation","sim_mode",-1,full_ini_path.c_str() );
+		sim_mode = (SimulationMode)GetProfileInt( "simulation","sim_mode",-1 );
 		ThrowIfFalse( (int)sim_mode >= 0 && (int)sim_mode < (int)SimulationMode::Count,
 			"Bad simulation mode: " + std::to_string( (int)sim_mode )
 		);
 		// load map filename
-		GetPrivateProfileStringA( "simulation","map",nullptr,buffer,sizeof( buffer ),full_ini_path.c_str() );
-		map_filename = "Maps\\"s + buffer;
+		map_filename = "Maps/"s + GetProfileString( "simulation","map" );
 		ThrowIfFalse( map_filename != "","Filename not set." );
+		// map id inside a corpus archive (.rmc map file), the evaluator picks its own per run
+		mapIndex = GetProfileInt( "simulation","map_index",0 );
 		// load screen width and height
-		screenWidth = GetPrivateProfileIntA( "display","screenwidth",-1,full_ini_path.c_str() );
-		screenHeight = GetPrivateProfileIntA( "display","screenheight",-1,full_ini_path.c_str() );
+		screenWidth = GetProfileInt( "display","screenwidth",-1 );
+		screenHeight = GetProfileInt( "display","screenheight",-1 );
 		// load map mode setting
-		map_mode = (MapMode)GetPrivateProfileIntA( "simulation","map_mode",-1,full_ini_path.c_str() );
+		map_mode = (MapMode)GetProfileInt( "simulation","map_mode",-1 );
 		ThrowIfFalse( (int)map_mode >= 0 && (int)map_mode < (int)MapMode::Count,
 			"Bad map mode: " + std::to_string( (int)map_mode )
 		);
 		// load direction (Count signifies random)
-		dir = (Direction::Type)GetPrivateProfileIntA( "simulation","direction",-1,full_ini_path.c_str() );
+		dir = (Direction::Type)GetProfileInt( "simulation","direction",-1 );
 		ThrowIfFalse( (int)dir >= 0 && (int)dir <= (int)Direction::Type::Count,
 			"Bad start direction code: " + std::to_string( (int)dir )
 		);
 		// load goal spawn mode
-		goalMode = (GoalMode)GetPrivateProfileIntA( "simulation","goal_spawn",-1,full_ini_path.c_str() );
+		goalMode = (GoalMode)GetProfileInt( "simulation","goal_spawn",-1 );
 		ThrowIfFalse( (int)goalMode >= 0 && (int)goalMode < (int)GoalMode::Count,
 			"Bad goal spawn mode code: " + std::to_string( (int)goalMode )
 		);
 		// load map width and height
-		mapWidth = GetPrivateProfileIntA( "simulation","map_width",-1,full_ini_path.c_str() );
-		mapHeight = GetPrivateProfileIntA( "simulation","map_height",-1,full_ini_path.c_str() );
+		mapWidth = GetProfileInt( "simulation","map_width",-1 );
+		mapHeight = GetProfileInt( "simulation","map_height",-1 );
 		// load map proc extra info
-		roomTries = GetPrivateProfileIntA( "simulation","map_room",-1,full_ini_path.c_str() );
-		extraDoors = GetPrivateProfileIntA( "simulation","extra_doors",-1,full_ini_path.c_str() );
+		roomTries = GetProfileInt( "simulation","map_room",-1 );
+		extraDoors = GetProfileInt( "simulation","extra_doors",-1 );
+		// procedural generator version, a seed only reproduces a map under the
+		// version it was generated with (1 = original corridors, 2 = frontier carver,
+		// 3 = frontier carver and union find doors, 4 = 3 on regions generated in parallel)
+		generatorVersion = GetProfileInt( "simulation","generator",1 );
+		Require( generatorVersion >= 1 && generatorVersion <= 4,
+			"Bad generator version: " + std::to_string( generatorVersion )
+		);
+		// generator 4 region threads (0 means one per hardware thread), the map does not depend on it
+		nRegionThreads = GetProfileInt( "simulation","region_threads",0 );
 		// load seed
-		seed = GetPrivateProfileIntA( "simulation","seed",-1,full_ini_path.c_str() );
+		seed = GetProfileInt( "simulation","seed",-1 );
 		// max moves
-		maxMoves = GetPrivateProfileIntA( "simulation","max_moves",-1,full_ini_path.c_str() );
+		maxMoves = GetProfileInt( "simulation","max_moves",-1 );
 		// n runs
-		nRuns = GetPrivateProfileIntA( "simulation","runs",-1,full_ini_path.c_str() );
+		nRuns = GetProfileInt( "simulation","runs",-1 );
+		// evaluator worker threads (0 means one per hardware thread)
+		nWorkers = GetProfileInt( "simulation","workers",0 );
+		// evaluator map generator threads, 0 means each simulation job generates its own map
+		nGeneratorWorkers = GetProfileInt( "simulation","generator_workers",0 );
+		// maps generated ahead of the simulations (0 means two per generator thread)
+		prefetchDepth = GetProfileInt( "simulation","prefetch",0 );
+		// evaluator memory budget in MB for live simulations (0 means unlimited)
+		memoryBudget = GetProfileInt( "simulation","memory_budget",0 );
+		// evaluator results file
+		results_filename = GetProfileString( "simulation","results" );
+		if( results_filename.empty() )
+		{
+			results_filename = "results.txt";
+		}
+		// registered ai name for batch runs (empty means the RoboAI typedef)
+		ai_name = GetProfileString( "simulation","ai" );
+		// failure snapshots with run length encoded rows
+		failureRle = GetProfileInt( "simulation","failure_rle",0 ) != 0;
+		// 0=text 1=csv 2=json lines
+		resultsFormat = GetProfileInt( "simulation","results_format",0 );
+		Require( resultsFormat >= 0 && resultsFormat < 3,
+			"Bad results format: " + std::to_string( resultsFormat )
+		);
 	}
 	std::string GetMapFilename() const
 	{
 		assert( GetMapMode() != MapMode::Procedural );
 		return map_filename;
 	}
+	int GetMapIndex() const
+	{
+		assert( GetMapMode() != MapMode::Procedural );
+		return mapIndex;
+	}
 	int GetMaxMoves() const
 	{
 		return maxMoves;
@@ -137,6 +209,11 @@ public:
 		assert( map_mode == MapMode::Procedural );
 		return roomTries;
 	}
+	int GetGeneratorVersion() const
+	{
+		assert( map_mode == MapMode::Procedural );
+		return generatorVersion;
+	}
 	bool IsRandomStartDirection() const
 	{
 		return dir == Direction::Type::Count;
@@ -163,23 +240,171 @@ public:
 	{
 		return nRuns;
 	}
+	int GetNumberWorkers() const
+	{
+		if( nWorkers > 0 )
+		{
+			return nWorkers;
+		}
+		return std::max( (int)std::thread::hardware_concurrency(),1 );
+	}
+	int GetNumberRegionThreads() const
+	{
+		if( nRegionThreads > 0 )
+		{
+			return nRegionThreads;
+		}
+		return std::max( (int)std::thread::hardware_concurrency(),1 );
+	}
+	int GetNumberGeneratorWorkers() const
+	{
+		return std::max( nGeneratorWorkers,0 );
+	}
+	// only meaningful with generator workers
+	int GetPrefetchDepth() const
+	{
+		if( prefetchDepth > 0 )
+		{
+			return prefetchDepth;
+		}
+		return 2 * std::max( nGeneratorWorkers,1 );
+	}
+	const std::string& GetResultsFilename() const
+	{
+		return results_filename;
+	}
+	// ResultsWriter::Format code
+	int GetResultsFormatCode() const
+	{
+		return resultsFormat;
+	}
+	size_t GetMemoryBudget() const
+	{
+		return (size_t)std::max( memoryBudget,0 ) << 20;
+	}
+	const std::string& GetAiName() const
+	{
+		return ai_name;
+	}
+	void SetAiName( const std::string& name )
+	{
+		ai_name = name;
+	}
 	unsigned int GetSeed() const
 	{
 		return (unsigned int)seed;
 	}
+	bool IsFailureRle() const
+	{
+		return failureRle;
+	}
+	// fnv-1a over everything that decides how a single run plays out (apart from
+	// its seed), so two runs with the same seed and hash are the same run
+	uint32_t GetRunHash() const
+	{
+		uint32_t hash = 2166136261u;
+		const auto Mix = [&hash]( const std::string& str )
+		{
+			for( const char c : str )
+			{
+				hash = (hash ^ (unsigned char)c) * 16777619u;
+			}
+			hash = (hash ^ 0xFFu) * 16777619u;
+		};
+		Mix( std::to_string( (int)map_mode ) );
+		if( map_mode == MapMode::File )
+		{
+			Mix( map_filename );
+			// (map 0 hashes like a plain map file)
+			if( mapIndex != 0 )
+			{
+				Mix( std::to_string( mapIndex ) );
+			}
+		}
+		else
+		{
+			Mix( std::to_string( (int)goalMode ) );
+			Mix( std::to_string( mapWidth ) + "x" + std::to_string( mapHeight ) );
+			Mix( std::to_string( roomTries ) + "," + std::to_string( extraDoors ) );
+			// (generator 1 hashes like it did before there were versions)
+			if( generatorVersion != 1 )
+			{
+				Mix( "generator " + std::to_string( generatorVersion ) );
+			}
+		}
+		Mix( std::to_string( maxMoves ) );
+		Mix( std::to_string( (int)dir ) );
+		Mix( ai_name );
+		return hash;
+	}
+private:
+	// minimal portable replacement for GetPrivateProfile*
+	// keys are stored as "section.key", quotes around values are stripped
+	static std::unordered_map<std::string,std::string> LoadIni( const std::string& filename )
+	{
+		std::unordered_map<std::string,std::string> ini;
+		std::ifstream file( filename );
+		const auto Trim = []( const std::string& str )
+		{
+			const auto first = str.find_first_not_of( " \t\r" );
+			if( first == std::string::npos )
+			{
+				return std::string{};
+			}
+			const auto last = str.find_last_not_of( " \t\r" );
+			return str.substr( first,last - first + 1 );
+		};
+		std::string section;
+		for( std::string line; std::getline( file,line ); )
+		{
+			line = Trim( line );
+			if( line.empty() || line.front() == ';' || line.front() == '#' )
+			{
+				continue;
+			}
+			if( line.front() == '[' )
+			{
+				section = Trim( line.substr( 1,line.find( ']' ) - 1 ) );
+				continue;
+			}
+			const auto eq = line.find( '=' );
+			if( eq == std::string::npos )
+			{
+				continue;
+			}
+			auto value = Trim( line.substr( eq + 1 ) );
+			if( value.size() >= 2 && value.front() == '"' && value.back() == '"' )
+			{
+				value = value.substr( 1,value.size() - 2 );
+			}
+			ini[section + "." + Trim( line.substr( 0,eq ) )] = value;
+		}
+		return ini;
+	}
 private:
 	std::string map_filename;
+	std::string results_filename;
+	std::string ai_name;
 	SimulationMode sim_mode;
 	MapMode map_mode;
 	GoalMode goalMode;
+	int mapIndex;
 	int mapWidth;
 	int mapHeight;
 	int roomTries;
 	int extraDoors;
+	int generatorVersion;
+	int nRegionThreads;
 	int screenWidth;
 	int screenHeight;
 	int maxMoves;
 	int nRuns;
+	int nWorkers;
+	int nGeneratorWorkers;
+	int prefetchDepth;
+	int memoryBudget;
+	int resultsFormat;
+	bool failureRle;
 	int seed;
 	Direction::Type dir;
 };
\ No newline at end of file
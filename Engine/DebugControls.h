@@ -16,7 +16,10 @@ public:
 		:
 		map( map ),
 		robo( robo )
-	{}
+	{
+		// marks are drawn from the map's color layer
+		map.EnableColorLayer();
+	}
 	DebugControls( const DebugControls& ) = delete;
 	DebugControls& operator=( const DebugControls& ) = delete;
 	void MarkAt( const Vei2& pos,Color color )
@@ -161,4 +161,9 @@ private:
 	}
 private:
 	Vei2 dir;
-};
\ No newline at end of file
+};
+
+// unit steps to the 4 neighbors of a cell in RotateClockwise() order from up,
+// so neighbor loops run over constants instead of rotating a Direction
+constexpr int neighborDx[4] = { 0,1,0,-1 };
+constexpr int neighborDy[4] = { -1,0,1,0 };
\ No newline at end of file
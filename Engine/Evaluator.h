@@ -2,146 +2,387 @@
 
 #include "Simulator.h"
 #include "Config.h"
+#include "ThreadPool.h"
+#include "SimScheduler.h"
+#include "MemoryBudget.h"
+#include "Channel.h"
+#include "ResultsWriter.h"
+#include "FailureWriter.h"
+#ifndef ROBOMAZE_HEADLESS
+#include "Assets.h"
 #include "Graphics.h"
 #include "Gameable.h"
+#endif
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <ostream>
 #include <algorithm>
-#include <numeric>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <exception>
+#include <chrono>
 
-class Evaluator : public Gameable
+class Evaluator
+#ifndef ROBOMAZE_HEADLESS
+	: public Gameable
+#endif
 {
 private:
-	struct Result
+	typedef ResultsWriter::Record Result;
+	// a run's map and what it was made from (made by a generator, or by the run's first slice)
+	struct Prepared
 	{
-		size_t seed;
-		float time;
-		int nMoves;
-		Simulator::State result;
+		int index;
+		Config config;
+		unsigned int seed;
+		size_t bytes;
+		TileMap map;
 	};
+	// a run on the scheduler, sim (and job, unless a generator handed it over
+	// ready) is set up by its first slice
+	struct ScheduledRun
+	{
+		std::function<std::unique_ptr<Prepared>()> makeJob;
+		std::unique_ptr<Prepared> job;
+		std::unique_ptr<BatchSimulator> sim;
+		// budget held for the run, 0 while it holds none
+		size_t bytes = 0u;
+	};
+	// moves per scheduler slice
+	static constexpr int sliceMoves = 4096;
 public:
-	Evaluator( const Config& config )
+	// pEcho optionally receives a text copy of the results as they stream in
+	Evaluator( const Config& config,std::ostream* pEcho = nullptr )
 		:
-		seed( config.GetSeed() )
+		seed( config.GetSeed() ),
+		nRuns( std::max( config.GetNumberRuns(),1 ) ),
+		done( donePromise.get_future() ),
+		budget( config.GetMemoryBudget(),2 * config.GetNumberWorkers() +
+			(config.GetNumberGeneratorWorkers() > 0 ? config.GetPrefetchDepth() : 0)
+		),
+		failures( config.IsFailureRle() ),
+		scheduler( config.GetNumberWorkers() )
 	{
-		std::mt19937 seed_gen( seed );
-		for( int n = 0; n < config.GetNumberRuns() - 1; n++ )
+		if( config.GetNumberGeneratorWorkers() > 0 )
 		{
-			simulations.push_back( GenerateSimulation( config,seed_gen() ) );
+			generators = std::make_unique<ThreadPool>( config.GetNumberGeneratorWorkers() );
 		}
-		// stress
-		auto& calias = config;
+		// fail on an unknown ai here rather than inside every job
+		AiRegistry<BatchSimulator>::Find( config.GetAiName() );
+		// same for a damaged or empty corpus archive
+		if( config.GetMapMode() == Config::MapMode::File && MapArchive::IsArchiveFile( config.GetMapFilename() ) &&
+			MapArchive::Open( config.GetMapFilename() )->GetCount() == 0 )
 		{
-			Config config = calias;
-			config.goalMode = Config::GoalMode::Random;
-			config.mapWidth = 1000;
-			config.mapHeight = 1000;
-			config.roomTries = (config.mapWidth + config.mapHeight) / 2;
-			config.extraDoors = (config.mapWidth + config.mapHeight) / 2;
-			config.maxMoves = config.mapWidth * config.mapHeight * 4;
-			simulations.push_back( std::make_unique<HeadlessSimulator>( config,seed_gen() ) );
+			throw std::runtime_error( "Map archive '" + config.GetMapFilename() + "' holds no maps." );
 		}
+		writers.push_back( std::make_unique<ResultsWriter>(
+			config.GetResultsFilename(),(ResultsWriter::Format)config.GetResultsFormatCode(),seed
+		) );
+		if( pEcho )
+		{
+			writers.push_back( std::make_unique<ResultsWriter>(
+				*pEcho,ResultsWriter::Format::Text,seed
+			) );
+		}
+		// results are drained from the channel as jobs complete, independent of any frame loop
+		collector = std::thread( &Evaluator::Collect,this );
+		// configs are materialized from the seed stream on demand, so only the
+		// simulations admitted by the memory budget exist at any one time
+		feeder = std::thread( &Evaluator::Feed,this,config );
 	}
+#ifndef ROBOMAZE_HEADLESS
 	void Update( MainWindow& wnd,float dt ) override
 	{
-		while( !IsFinished() && simulations.back()->Finished() )
+		// results were already written by the collector, just report
+		if( IsFinished() && !announced )
 		{
-			const auto& s = *simulations.back();
-			if (s.GetState() == Simulator::State::Failure)
-			{
-				s.map.Save("failmaze.txt");
-			}
-			
-			results.push_back( {
-				s.GetSeed(),
-				s.GetWorkingTime(),
-				s.GetMoveCount(),
-				s.GetState()
-			} );
-			simulations.pop_back();
-		}
-
-		if( !IsFinished() )
-		{
-			simulations.back()->Update( wnd,dt );
-		}
-		else if( !written )
-		{
-			WriteResults();
+			announced = true;
+			// rethrows whatever made the evaluation fail
+			done.get();
 			wnd.ShowMessageBox( L"Finished",L"Done!" );
 			wnd.Kill();
 		}
 	}
 	void Draw( Graphics& gfx ) const override
 	{
-		if( !IsFinished() )
+		font.DrawText(
+			std::to_string( nCompleted ) + "/" + std::to_string( nRuns ),
+			{ Graphics::GetScreenRect().left + 5,Graphics::GetScreenRect().bottom - 30 },
+			Colors::White,gfx
+		);
+	}
+#endif
+	~Evaluator()
+	{
+		// stop feeding and skip whatever is still queued when torn down early
+		dying = true;
+		budget.Abort();
+		if( feeder.joinable() )
 		{
-			simulations.back()->Draw( gfx );
+			feeder.join();
 		}
+		channel.Close();
+		collector.join();
+	}
+	// blocks until the last result has been collected and the summary written (no window required)
+	// rethrows the first exception a run threw, the evaluation stops at that point
+	void Run()
+	{
+		done.get();
+	}
+	// per-run config derived from the run seed
+	static Config GenerateConfig( Config config,unsigned int seed )
+	{
+		std::mt19937 param_gen( seed );
+		std::discrete_distribution<> spawn_d = { 10,45,35,5,5 };
+		std::uniform_int_distribution<int> size_d( 20,300 );
+		config.goalMode = (Config::GoalMode)spawn_d( param_gen );
+		config.mapWidth = size_d( param_gen );
+		config.mapHeight = size_d( param_gen );
+		config.roomTries = (config.mapWidth * config.mapHeight) / 6000;
+		config.extraDoors = (config.mapWidth + config.mapHeight) / 2;
+		config.maxMoves = config.mapWidth * config.mapHeight * 4;
+		return config;
+	}
+	// 1000x1000 map appended to every evaluation
+	static Config MakeStressConfig( Config config )
+	{
+		config.goalMode = Config::GoalMode::Random;
+		config.mapWidth = 1000;
+		config.mapHeight = 1000;
+		config.roomTries = (config.mapWidth + config.mapHeight) / 2;
+		config.extraDoors = (config.mapWidth + config.mapHeight) / 2;
+		config.maxMoves = config.mapWidth * config.mapHeight * 4;
+		return config;
 	}
 	bool IsFinished() const
 	{
-		return simulations.empty();
+		return done.wait_for( std::chrono::seconds::zero() ) == std::future_status::ready;
 	}
-	void WriteResults()
+private:
+	void Feed( Config config )
 	{
-		std::ofstream file( "results.txt" );
-		file << "  Master seed: [" << seed << "]\n" <<
-			    "=========================================" << std::endl;
-		for( const auto& r : results )
+		// runs already fill every worker, a generator 4 map made inside one must not
+		// start a thread per hardware thread of its own (the map is the same either way)
+		config.nRegionThreads = 1;
+		std::mt19937 seed_gen( seed );
+		// stress (last seed in the stream, but scheduled first so it does not end up as the tail)
 		{
-			file << std::endl << " [" << r.seed << "]\n";
-			file << "Result: " << ((r.result == Simulator::State::Success) ? "Success\n" : "Failure\n");
-			file << "Moves taken:" << r.nMoves << std::endl;
-			file << "Time taken:" << r.time << std::endl;
+			auto stress_gen = seed_gen;
+			stress_gen.discard( nRuns - 1 );
+			if( !Schedule( nRuns - 1,MakeStressConfig( config ),stress_gen() ) )
+			{
+				return;
+			}
 		}
-
-		// write totals
-		const auto total_time = std::accumulate( results.begin(),results.end(),0.0f,
-			[]( float s,const Result& r )
+		for( int n = 0; n < nRuns - 1; n++ )
+		{
+			const auto s = seed_gen();
+			if( !Schedule( n,GenerateConfig( config,s ),s ) )
 			{
-				return s + r.time;
+				return;
 			}
-		);
-		const auto total_moves = std::accumulate( results.begin(),results.end(),0,
-			[]( int s,const Result& r )
+		}
+	}
+	bool Schedule( int index,Config config,unsigned int seed )
+	{
+		// a corpus archive is swept in order, run n plays map n (wrapping around)
+		if( config.GetMapMode() == Config::MapMode::File && MapArchive::IsArchiveFile( config.GetMapFilename() ) )
+		{
+			config.mapIndex = index % MapArchive::Open( config.GetMapFilename() )->GetCount();
+		}
+		const auto bytes = Simulator::EstimateMemoryFootprint( config );
+		if( !budget.Acquire( bytes ) )
+		{
+			return false;
+		}
+		if( !generators )
+		{
+			auto run = std::make_shared<ScheduledRun>();
+			run->bytes = bytes;
+			run->makeJob = [index,config,seed,bytes]()
+			{
+				return std::make_unique<Prepared>( Prepared{ index,config,seed,bytes,Simulator::LoadMap( config,seed ) } );
+			};
+			scheduler.Submit( [this,run]() { return StepRun( *run ); },[this,run]() { FinishRun( *run ); } );
+			return true;
+		}
+		// pipelined: a generator makes the map ahead of time and only then hands
+		// the run to the scheduler, so no scheduler worker ever waits for a map
+		generators->Submit( [this,index,config,seed,bytes]()
+		{
+			std::unique_ptr<Prepared> p;
+			if( !dying )
 			{
-				return s + r.nMoves;
+				try
+				{
+					p = std::make_unique<Prepared>( Prepared{ index,config,seed,bytes,Simulator::LoadMap( config,seed ) } );
+				}
+				catch( ... )
+				{
+					Fail( std::current_exception() );
+				}
 			}
-		);
-		const auto nSuccess = std::count_if( results.begin(),results.end(),
-			[]( const Result& r )
+			if( !p )
 			{
-				return r.result == Simulator::State::Success;
+				budget.Release( bytes );
+				return;
 			}
-		);
-
-		file << std::endl << std::endl
-			<< "========================================\n"
-			<< "Success Rate: " << nSuccess << "/" << results.size() << std::endl
-			<< "Total Moves: " << total_moves << std::endl
-			<< "Total Time: " << total_time;
-
-		written = true;
+			auto run = std::make_shared<ScheduledRun>();
+			run->bytes = bytes;
+			run->job = std::move( p );
+			scheduler.Submit( [this,run]() { return StepRun( *run ); },[this,run]() { FinishRun( *run ); } );
+		} );
+		return true;
 	}
-private:
-	std::unique_ptr<Simulator> GenerateSimulation( Config config,unsigned int seed )
+	// one scheduler slice of a run: the first one makes the map (unless it came
+	// ready) and sets up the simulation, every later one plays sliceMoves moves,
+	// so a stress run shares the workers with the small runs instead of holding
+	// one of them until it is done
+	bool StepRun( ScheduledRun& run )
 	{
-		std::mt19937 param_gen( seed );
-		std::discrete_distribution<> spawn_d = { 10,45,35,5,5 };
-		std::uniform_int_distribution<int> size_d( 20,300 );
-		config.goalMode = (Config::GoalMode)spawn_d( param_gen );
-		config.mapWidth = size_d( param_gen );
-		config.mapHeight = size_d( param_gen );
-		config.roomTries = (config.mapWidth * config.mapHeight) / 6000;
-		config.extraDoors = (config.mapWidth + config.mapHeight) / 2;
-		config.maxMoves = config.mapWidth * config.mapHeight * 4;
-		return std::make_unique<HeadlessSimulator>( config,seed );
+		// skip whatever is still queued when torn down early (or after a run failed)
+		if( dying )
+		{
+			return false;
+		}
+		try
+		{
+			if( !run.sim )
+			{
+				if( !run.job )
+				{
+					run.job = run.makeJob();
+				}
+				run.sim = std::make_unique<BatchSimulator>( run.job->config,run.job->seed,std::move( run.job->map ) );
+				return true;
+			}
+			return run.sim->Step( sliceMoves );
+		}
+		catch( ... )
+		{
+			Fail( std::current_exception() );
+			return false;
+		}
+	}
+	// after a run's last slice: reports it if it played to the end, frees it and
+	// gives its memory back to the budget
+	void FinishRun( ScheduledRun& run )
+	{
+		try
+		{
+			if( run.sim && run.sim->Finished() && !dying )
+			{
+				channel.Push( MakeResult( *run.job,*run.sim ) );
+			}
+		}
+		catch( ... )
+		{
+			Fail( std::current_exception() );
+		}
+		run.sim.reset();
+		run.job.reset();
+		if( run.bytes != 0u )
+		{
+			budget.Release( run.bytes );
+		}
+	}
+	Result MakeResult( const Prepared& job,BatchSimulator& sim )
+	{
+		// result is read out before the map is handed to the failure writer
+		Result r = {
+			job.index,
+			sim.GetSeed(),
+			sim.map.GetGridWidth(),
+			sim.map.GetGridHeight(),
+			job.config.GetMapMode() == Config::MapMode::Procedural ?
+				job.config.GetGoalMode() : Config::GoalMode::Count,
+			sim.GetMoveCount(),
+			sim.GetWorkingTime(),
+			sim.GetReplanCount(),
+			sim.GetState(),
+			sim.GetPlanLatency()
+		};
+		if( sim.GetState() == Simulator::State::Failure )
+		{
+			failures.Submit( sim.GetSeed(),job.config.GetRunHash(),std::move( sim.map ) );
+		}
+		return r;
+	}
+	// called from a job whose run threw: stops feeding and running, and has the
+	// collector hand the (first) error to Run() instead of waiting for results
+	void Fail( std::exception_ptr e )
+	{
+		{
+			std::lock_guard<std::mutex> lock( errorMutex );
+			if( !error )
+			{
+				error = e;
+			}
+		}
+		dying = true;
+		budget.Abort();
+		channel.Close();
+	}
+	// runs on the collector thread, finishes the evaluation as soon as the last job reports
+	void Collect()
+	{
+		// records carry a histogram, reuse one rather than reallocating per pop
+		Result r;
+		while( channel.Pop( r ) )
+		{
+			for( auto& w : writers )
+			{
+				w->Write( r );
+			}
+			if( ++nCompleted == nRuns )
+			{
+				for( auto& w : writers )
+				{
+					w->Finish();
+				}
+				// every failure was queued before its result, wait for them to hit the disk
+				failures.Finish();
+				donePromise.set_value();
+				return;
+			}
+		}
+		// closed before the last result, either torn down or a run failed
+		std::lock_guard<std::mutex> lock( errorMutex );
+		if( error )
+		{
+			donePromise.set_exception( error );
+		}
 	}
 private:
 	unsigned int seed;
-	bool written = false;
-	std::vector<std::unique_ptr<Simulator>> simulations;
-	std::vector<Result> results;
+	int nRuns;
+	bool announced = false;
+	std::atomic<int> nCompleted = 0;
+	std::atomic<bool> dying = false;
+	std::promise<void> donePromise;
+	std::future<void> done;
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	// only touched by the collector thread
+	std::vector<std::unique_ptr<ResultsWriter>> writers;
+	Channel<Result> channel;
+	std::thread collector;
+#ifndef ROBOMAZE_HEADLESS
+	// shared through the asset cache instead of loaded per instance
+	const Font& font = Assets::GetFont( "Images/Fixedsys16x28.bmp" );
+#endif
+	MemoryBudget budget;
+	FailureWriter failures;
+	// declared after everything the jobs touch so workers are joined first, and
+	// generators after the scheduler they submit to (runs waiting for a slice are
+	// held by the budget's holder cap, which counts the prefetch depth)
+	SimScheduler scheduler;
+	// null unless generator_workers is set
+	std::unique_ptr<ThreadPool> generators;
+	std::thread feeder;
 };
\ No newline at end of file
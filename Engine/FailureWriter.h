@@ -0,0 +1,70 @@
+#pragma once
+
+#include "TileMap.h"
+#include "Channel.h"
+#include <string>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <cstdio>
+
+// writes failed maps to disk on its own thread, so simulation workers hand a
+// failure over and carry on instead of waiting on the file system
+// each snapshot gets its own file named by run seed and config hash, nothing is
+// overwritten and everything queued is written before Finish() returns
+class FailureWriter
+{
+public:
+	explicit FailureWriter( bool rle )
+		:
+		rle( rle ),
+		worker( &FailureWriter::Work,this )
+	{}
+	FailureWriter( const FailureWriter& ) = delete;
+	FailureWriter& operator=( const FailureWriter& ) = delete;
+	~FailureWriter()
+	{
+		Finish();
+	}
+	// takes the map over, it is serialized and freed on the writer thread
+	void Submit( unsigned int seed,uint32_t configHash,TileMap map )
+	{
+		queue.Push( { MakeFilename( seed,configHash ),std::make_unique<TileMap>( std::move( map ) ) } );
+	}
+	// drains the queue and stops the writer, no Submit() after this
+	void Finish()
+	{
+		queue.Close();
+		if( worker.joinable() )
+		{
+			worker.join();
+		}
+	}
+	static std::string MakeFilename( unsigned int seed,uint32_t configHash )
+	{
+		char hash[9];
+		std::snprintf( hash,sizeof( hash ),"%08x",(unsigned int)configHash );
+		return "failmaze_" + std::to_string( seed ) + "_" + hash + ".txt";
+	}
+private:
+	struct Snapshot
+	{
+		std::string filename;
+		std::unique_ptr<TileMap> pMap;
+	};
+private:
+	void Work()
+	{
+		Snapshot s;
+		while( queue.Pop( s ) )
+		{
+			s.pMap->Save( s.filename,rle );
+			s.pMap.reset();
+		}
+	}
+private:
+	bool rle;
+	Channel<Snapshot> queue;
+	// last, so it starts after the queue exists
+	std::thread worker;
+};
\ No newline at end of file
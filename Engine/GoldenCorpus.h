@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Simulator.h"
+#include "Evaluator.h"
+#include "Config.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <stdexcept>
+
+// pinned set of maps / seeds replayed against a checked-in baseline
+// corpus lines:   <kind> <source> <seed> [overrides]
+// baseline lines: <kind> <source> <seed> [overrides] <result> <moves> <plan time>
+// kinds: map (file map, seed picks the start direction), proc (evaluator config
+// derived from seed), stress (1000x1000 evaluator stress config); source is '-'
+// for generated maps. overrides replace the base config per entry:
+// generator=<version> and ai=<registered name>. lines starting with '#' are comments
+class GoldenCorpus
+{
+public:
+	struct Entry
+	{
+		std::string kind;
+		std::string source;
+		unsigned int seed;
+		// 0 / empty keep the base config's
+		int generatorVersion = 0;
+		std::string ai;
+		std::string GetKey() const
+		{
+			std::string key = kind + " " + source + " " + std::to_string( seed );
+			if( generatorVersion != 0 )
+			{
+				key += " generator=" + std::to_string( generatorVersion );
+			}
+			if( !ai.empty() )
+			{
+				key += " ai=" + ai;
+			}
+			return key;
+		}
+		// false if token is not a key=value override
+		bool ReadOverride( const std::string& token )
+		{
+			const auto eq = token.find( '=' );
+			if( eq == std::string::npos )
+			{
+				return false;
+			}
+			const auto key = token.substr( 0,eq );
+			const auto value = token.substr( eq + 1 );
+			if( key == "generator" )
+			{
+				generatorVersion = std::stoi( value );
+				if( generatorVersion < 1 || generatorVersion > 4 )
+				{
+					throw std::runtime_error( "Bad golden corpus generator version '" + value + "'." );
+				}
+			}
+			else if( key == "ai" )
+			{
+				ai = value;
+			}
+			else
+			{
+				throw std::runtime_error( "Unknown golden corpus override '" + token + "'." );
+			}
+			return true;
+		}
+	};
+	struct Outcome
+	{
+		Simulator::State result;
+		int nMoves;
+		float time;
+	};
+public:
+	GoldenCorpus( const std::string& corpusFilename,const Config& base )
+		:
+		base( base )
+	{
+		const auto ThrowIfFalse = [&corpusFilename]( bool pred,const std::string& msg )
+		{
+			if( !pred )
+			{
+				throw std::runtime_error( "Golden corpus load error (" + corpusFilename + ").\n" + msg );
+			}
+		};
+		std::ifstream file( corpusFilename );
+		ThrowIfFalse( file.good(),"File could not be opened." );
+		int nLine = 0;
+		for( std::string line; std::getline( file,line ); )
+		{
+			nLine++;
+			std::istringstream iss( line );
+			Entry e;
+			if( !(iss >> e.kind) || e.kind.front() == '#' )
+			{
+				continue;
+			}
+			ThrowIfFalse( bool( iss >> e.source >> e.seed ),"Bad entry at line " + std::to_string( nLine ) + "." );
+			for( std::string token; iss >> token; )
+			{
+				ThrowIfFalse( e.ReadOverride( token ),"Bad override '" + token + "' at line " + std::to_string( nLine ) + "." );
+			}
+			ThrowIfFalse( e.kind == "map" || e.kind == "proc" || e.kind == "stress",
+				"Bad kind '" + e.kind + "' at line " + std::to_string( nLine ) + "."
+			);
+			entries.push_back( e );
+		}
+	}
+	const std::vector<Entry>& GetEntries() const
+	{
+		return entries;
+	}
+	Outcome Run( const Entry& e ) const
+	{
+		BatchSimulator sim( MakeConfig( e ),e.seed );
+		sim.Run();
+		return { sim.GetState(),sim.GetMoveCount(),sim.GetWorkingTime() };
+	}
+	static std::map<std::string,Outcome> LoadBaseline( const std::string& filename )
+	{
+		std::map<std::string,Outcome> baseline;
+		std::ifstream file( filename );
+		if( !file )
+		{
+			throw std::runtime_error( "Golden baseline '" + filename + "' could not be opened." );
+		}
+		for( std::string line; std::getline( file,line ); )
+		{
+			std::istringstream iss( line );
+			Entry e;
+			std::string result;
+			Outcome o;
+			if( !(iss >> e.kind) || e.kind.front() == '#' )
+			{
+				continue;
+			}
+			bool good = bool( iss >> e.source >> e.seed >> result );
+			while( good && e.ReadOverride( result ) )
+			{
+				good = bool( iss >> result );
+			}
+			if( !good || !(iss >> o.nMoves >> o.time) )
+			{
+				throw std::runtime_error( "Golden baseline '" + filename + "' bad line: " + line );
+			}
+			o.result = result == "success" ? Simulator::State::Success : Simulator::State::Failure;
+			baseline[e.GetKey()] = o;
+		}
+		return baseline;
+	}
+	static void WriteBaselineLine( std::ostream& out,const Entry& e,const Outcome& o )
+	{
+		out << e.GetKey() << " "
+			<< (o.result == Simulator::State::Success ? "success" : "failure") << " "
+			<< o.nMoves << " " << o.time << std::endl;
+	}
+private:
+	Config MakeConfig( const Entry& e ) const
+	{
+		Config config = base;
+		if( e.generatorVersion != 0 )
+		{
+			config.generatorVersion = e.generatorVersion;
+		}
+		if( !e.ai.empty() )
+		{
+			config.SetAiName( e.ai );
+		}
+		if( e.kind == "map" )
+		{
+			config.map_mode = Config::MapMode::File;
+			config.map_filename = e.source;
+			return config;
+		}
+		else if( e.kind == "proc" )
+		{
+			return Evaluator::GenerateConfig( config,e.seed );
+		}
+		else
+		{
+			return Evaluator::MakeStressConfig( config );
+		}
+	}
+private:
+	Config base;
+	std::vector<Entry> entries;
+};
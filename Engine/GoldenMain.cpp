@@ -0,0 +1,99 @@
+// replays the pinned golden corpus and compares against the checked-in baseline
+// usage: robomaze_golden [--update] [--time-tolerance <factor>] [golden dir]
+// run from the Engine directory; exits non-zero on any divergence in result / move
+// count, or when total plan time exceeds the baseline total by more than the
+// tolerance factor (default 2, 0 disables the timing check)
+// note: map generation goes through <random> distributions, so the baseline is
+// only valid for the standard library it was recorded with (libstdc++)
+#include "GoldenCorpus.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <exception>
+
+int main( int argc,char* argv[] )
+{
+	bool update = false;
+	double timeTolerance = 2.0;
+	std::string dir = "Golden";
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		if( arg == "--update" )
+		{
+			update = true;
+		}
+		else if( arg == "--time-tolerance" && i + 1 < argc )
+		{
+			timeTolerance = std::stod( argv[++i] );
+		}
+		else
+		{
+			dir = arg;
+		}
+	}
+
+	try
+	{
+		const GoldenCorpus corpus( dir + "/corpus.txt",Config( dir + "/golden.ini" ) );
+		const auto baselineFilename = dir + "/baseline.txt";
+
+		if( update )
+		{
+			std::ofstream file( baselineFilename );
+			file << "# kind source seed result moves plan_time" << std::endl;
+			for( const auto& e : corpus.GetEntries() )
+			{
+				const auto o = corpus.Run( e );
+				GoldenCorpus::WriteBaselineLine( file,e,o );
+				GoldenCorpus::WriteBaselineLine( std::cout,e,o );
+			}
+			return 0;
+		}
+
+		const auto baseline = GoldenCorpus::LoadBaseline( baselineFilename );
+		int nDiverged = 0;
+		double totalTime = 0.0;
+		double totalBaselineTime = 0.0;
+		for( const auto& e : corpus.GetEntries() )
+		{
+			const auto i = baseline.find( e.GetKey() );
+			if( i == baseline.end() )
+			{
+				std::cout << "MISSING  " << e.GetKey() << " (not in baseline)" << std::endl;
+				nDiverged++;
+				continue;
+			}
+			const auto& expected = i->second;
+			const auto o = corpus.Run( e );
+			totalTime += o.time;
+			totalBaselineTime += expected.time;
+			const bool ok = o.result == expected.result && o.nMoves == expected.nMoves;
+			if( !ok )
+			{
+				nDiverged++;
+			}
+			std::cout << (ok ? "ok       " : "DIVERGED ") << e.GetKey()
+				<< " moves " << o.nMoves << " (baseline " << expected.nMoves << ")"
+				<< " time " << o.time << " (baseline " << expected.time << ")" << std::endl;
+		}
+
+		std::cout << std::endl << nDiverged << " diverged of " << corpus.GetEntries().size()
+			<< ", total plan time " << totalTime << " (baseline " << totalBaselineTime << ")" << std::endl;
+		if( nDiverged != 0 )
+		{
+			return 1;
+		}
+		if( timeTolerance > 0.0 && totalTime > totalBaselineTime * timeTolerance )
+		{
+			std::cout << "plan time regression: more than " << timeTolerance << "x baseline" << std::endl;
+			return 1;
+		}
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_golden: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// log-linear bucketed histogram of non-negative integer samples (HdrHistogram style)
+// every power of two is split into 2^subBucketBits linear sub-buckets, so reported
+// percentiles are within 1/2^subBucketBits relative error while memory stays fixed
+class Histogram
+{
+public:
+	static constexpr int subBucketBits = 5;
+public:
+	void Record( uint64_t value )
+	{
+		counts[BucketIndex( value )]++;
+		count++;
+		sum += (double)value;
+		min = std::min( min,value );
+		max = std::max( max,value );
+	}
+	void Merge( const Histogram& other )
+	{
+		for( size_t i = 0; i < nBuckets; i++ )
+		{
+			counts[i] += other.counts[i];
+		}
+		count += other.count;
+		sum += other.sum;
+		min = std::min( min,other.min );
+		max = std::max( max,other.max );
+	}
+	uint64_t GetCount() const
+	{
+		return count;
+	}
+	uint64_t GetMin() const
+	{
+		return count != 0u ? min : 0u;
+	}
+	uint64_t GetMax() const
+	{
+		return max;
+	}
+	double GetSum() const
+	{
+		return sum;
+	}
+	double GetMean() const
+	{
+		return count != 0u ? sum / (double)count : 0.0;
+	}
+	// p in [0,100], returns the highest value equivalent to the bucket holding the p-th percentile
+	uint64_t GetPercentile( double p ) const
+	{
+		if( count == 0u )
+		{
+			return 0u;
+		}
+		const auto rank = std::max( (uint64_t)(p / 100.0 * (double)count + 0.5),(uint64_t)1u );
+		uint64_t seen = 0u;
+		for( size_t i = 0; i < nBuckets; i++ )
+		{
+			seen += counts[i];
+			if( seen >= rank )
+			{
+				return std::min( HighestEquivalentValue( (int)i ),max );
+			}
+		}
+		return max;
+	}
+private:
+	static constexpr uint64_t subBucketCount = uint64_t( 1 ) << subBucketBits;
+	static constexpr size_t nBuckets = (65 - subBucketBits) * subBucketCount;
+private:
+	static int MostSignificantBit( uint64_t value )
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64( &index,value );
+		return (int)index;
+#else
+		return 63 - __builtin_clzll( value );
+#endif
+	}
+	// values below 2 * subBucketCount map 1:1, above that each power of two
+	// gets subBucketCount buckets keyed by the top subBucketBits + 1 bits
+	static int BucketIndex( uint64_t value )
+	{
+		if( value < 2u * subBucketCount )
+		{
+			return (int)value;
+		}
+		const int shift = MostSignificantBit( value ) - subBucketBits;
+		return shift * (int)subBucketCount + (int)(value >> shift);
+	}
+	static uint64_t HighestEquivalentValue( int index )
+	{
+		if( index < 2 * (int)subBucketCount )
+		{
+			return (uint64_t)index;
+		}
+		const int shift = index / (int)subBucketCount - 1;
+		const uint64_t top = (uint64_t)(index % (int)subBucketCount) + subBucketCount;
+		return ((top + 1u) << shift) - 1u;
+	}
+private:
+	std::array<uint64_t,nBuckets> counts = {};
+	uint64_t count = 0u;
+	double sum = 0.0;
+	uint64_t min = std::numeric_limits<uint64_t>::max();
+	uint64_t max = 0u;
+};
@@ -0,0 +1,138 @@
+// compares Grid storage layouts (row major, 8x8 tiled, morton) on the breadth
+// first search the reachability pass / chili planner / corridor carver all do
+// usage: robomaze_layoutbench [ini file] [repeats] [stress|ini]  (run from the Engine directory)
+// stress (default) searches the evaluator stress map, ini the ini's own procedural map
+// size; every layout searches the same map from the start cell and must reach the
+// same cells at the same distances, the best of the repeats is printed
+#include "Config.h"
+#include "Evaluator.h"
+#include <iostream>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+
+struct SearchResult
+{
+	uint64_t checksum;
+	double seconds;
+	size_t bytes;
+};
+
+// layout bookkeeping has to agree with At() everywhere, including the border
+template<typename Layout>
+void CheckLayout( const Grid<char,Layout>& grid )
+{
+	for( int y = -1; y <= grid.GetHeight(); y++ )
+	{
+		for( int x = -1; x <= grid.GetWidth(); x++ )
+		{
+			const auto index = grid.GetIndex( x,y );
+			if( grid.GetPos( index ) != Vei2{ x,y } )
+			{
+				throw std::runtime_error( "layout GetPos does not invert GetIndex" );
+			}
+			if( !grid.Contains( x,y ) )
+			{
+				continue;
+			}
+			int i = 0;
+			grid.VisitNeighborIndices( index,[&]( size_t n )
+			{
+				if( n != grid.GetIndex( x + neighborDx[i],y + neighborDy[i] ) )
+				{
+					throw std::runtime_error( "layout neighbor index mismatch" );
+				}
+				i++;
+			} );
+		}
+	}
+}
+
+template<typename Layout>
+SearchResult Search( const TileMap& map,int nRepeats )
+{
+	// 1 = open, the sentinel border is wall
+	Grid<char,Layout> open( map.GetGridWidth(),map.GetGridHeight(),0,0 );
+	for( int y = 0; y < map.GetGridHeight(); y++ )
+	{
+		for( int x = 0; x < map.GetGridWidth(); x++ )
+		{
+			open.At( x,y ) = char( map.At( { x,y } ) != TileMap::TileType::Wall );
+		}
+	}
+	CheckLayout( open );
+
+	SearchResult result = { 0u,1e30,open.size() };
+	std::vector<size_t> frontier;
+	std::vector<size_t> next;
+	for( int r = 0; r < nRepeats; r++ )
+	{
+		Grid<int,Layout> dist( map.GetGridWidth(),map.GetGridHeight(),-1,-1 );
+		const auto start = std::chrono::steady_clock::now();
+		uint64_t checksum = 0u;
+		frontier.assign( 1,dist.GetIndex( map.GetStartPos() ) );
+		dist[frontier.front()] = 0;
+		for( int d = 1; !frontier.empty(); d++ )
+		{
+			next.clear();
+			for( const auto i : frontier )
+			{
+				open.VisitNeighborIndices( i,[&]( size_t n )
+				{
+					if( open[n] && dist[n] < 0 )
+					{
+						dist[n] = d;
+						next.push_back( n );
+					}
+				} );
+			}
+			checksum += (uint64_t)next.size() * d;
+			frontier.swap( next );
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		result.checksum = checksum;
+		result.seconds = std::min( result.seconds,elapsed.count() );
+	}
+	return result;
+}
+
+int main( int argc,char* argv[] )
+{
+	try
+	{
+		const Config config( argc > 1 ? argv[1] : "sim.ini" );
+		const int nRepeats = argc > 2 ? std::stoi( argv[2] ) : 10;
+		const bool useIni = argc > 3 && std::string( argv[3] ) == "ini";
+		std::mt19937 rng( config.GetSeed() );
+		const TileMap map( useIni ? config : Evaluator::MakeStressConfig( config ),rng );
+		std::cout << "map " << map.GetGridWidth() << "x" << map.GetGridHeight()
+			<< ", best of " << nRepeats << std::endl;
+
+		const auto rowMajor = Search<RowMajorLayout>( map,nRepeats );
+		const auto tiled = Search<TiledLayout>( map,nRepeats );
+		const auto morton = Search<MortonLayout>( map,nRepeats );
+		const auto print = [&rowMajor]( const char* name,const SearchResult& r )
+		{
+			std::cout << name << r.seconds * 1e3 << " ms  (x" << rowMajor.seconds / r.seconds
+				<< ", " << r.bytes << " cells)" << std::endl;
+		};
+		print( "row major: ",rowMajor );
+		print( "tiled:     ",tiled );
+		print( "morton:    ",morton );
+		if( tiled.checksum != rowMajor.checksum || morton.checksum != rowMajor.checksum )
+		{
+			std::cerr << "robomaze_layoutbench: searches diverged" << std::endl;
+			return 1;
+		}
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_layoutbench: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
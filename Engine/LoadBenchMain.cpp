@@ -0,0 +1,147 @@
+// load benchmark for the shipped maps
+// usage: robomaze_loadbench [repeats] [map files...]  (run from the Engine directory)
+// every map is loaded with the original stringstream parser, with the current
+// text parser and as .rmz (converted to a temp file first); the current loads
+// are checked against the reference and the mean load time of each is printed
+#include "TileMap.h"
+#include <iostream>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// the text loader as it was before the buffer parser
+struct ReferenceMap
+{
+	ReferenceMap( const std::string& filename )
+	{
+		const auto ThrowIfFalse = []( bool pred,const std::string& msg )
+		{
+			if( !pred )
+			{
+				throw std::runtime_error( "Tilemap load error.\n" + msg );
+			}
+		};
+
+		std::stringstream iss;
+		{
+			std::ifstream file( filename );
+			ThrowIfFalse( file.good(),"File: '" + filename + "' could not be opened." );
+			iss << file.rdbuf();
+		}
+		int gridWidth;
+		int gridHeight;
+		iss >> gridWidth >> gridHeight >> start_pos.x >> start_pos.y;
+		ThrowIfFalse( iss.good() && gridWidth > 0 && gridHeight > 0,"Bad header." );
+		tiles = Grid<TileMap::TileType>( gridWidth,gridHeight,TileMap::TileType::Invalid );
+		using namespace std::string_literals;
+		auto i = tiles.begin();
+		for( int y = 0; y < gridHeight; y++,i += tiles.GetWidth() )
+		{
+			std::string line;
+			iss >> line;
+			ThrowIfFalse( line.length() == (size_t)gridWidth,"Bad row width in tilemap at line " + std::to_string( y ) + "." );
+			std::transform(
+				line.begin(),line.end(),
+				i,
+				[=]( char c )
+			{
+				switch( c )
+				{
+				case '#':
+					return TileMap::TileType::Wall;
+				case '.':
+					return TileMap::TileType::Floor;
+				case '%':
+					return TileMap::TileType::Goal;
+				default:
+					ThrowIfFalse( false,"Bad tile: '"s + c + "' in line "s + std::to_string( y ) + "."s );
+					return TileMap::TileType::Wall;
+				}
+			} );
+		}
+		ThrowIfFalse( iss.get() == -1 && iss.eof(),"Unexpected token at end of tilemap / wrong map height." );
+	}
+	Grid<TileMap::TileType> tiles;
+	Vei2 start_pos;
+};
+
+bool Matches( const ReferenceMap& ref,const TileMap& map )
+{
+	if( ref.tiles.GetWidth() != map.GetGridWidth() || ref.tiles.GetHeight() != map.GetGridHeight() ||
+		ref.start_pos != map.GetStartPos() )
+	{
+		return false;
+	}
+	for( Vei2 pos = { 0,0 }; pos.y < map.GetGridHeight(); pos.y++ )
+	{
+		for( pos.x = 0; pos.x < map.GetGridWidth(); pos.x++ )
+		{
+			if( ref.tiles.At( pos ) != map.At( pos ) )
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// mean microseconds per call of load
+template<typename F>
+double TimeLoads( int nRepeats,F load )
+{
+	const auto start = std::chrono::steady_clock::now();
+	for( int i = 0; i < nRepeats; i++ )
+	{
+		load();
+	}
+	const std::chrono::duration<double,std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / nRepeats;
+}
+
+int main( int argc,char* argv[] )
+{
+	try
+	{
+		const int nRepeats = argc > 1 ? std::stoi( argv[1] ) : 20;
+		std::vector<std::string> files;
+		for( int i = 2; i < argc; i++ )
+		{
+			files.emplace_back( argv[i] );
+		}
+		if( files.empty() )
+		{
+			files = { "Maps/empty_map.txt","Maps/test_map.txt","Maps/failmaze.txt","Maps/map_proc.txt","failmaze.txt" };
+		}
+		const std::string rmzFile = "loadbench_tmp.rmz";
+		bool allMatch = true;
+		for( const auto& f : files )
+		{
+			const ReferenceMap ref( f );
+			const TileMap map( f,Direction::Up() );
+			map.SaveBinary( rmzFile );
+			const bool match = Matches( ref,map ) && Matches( ref,TileMap( rmzFile,Direction::Up() ) );
+			allMatch = allMatch && match;
+
+			const double tRef = TimeLoads( nRepeats,[&]() { ReferenceMap m( f ); } );
+			const double tText = TimeLoads( nRepeats,[&]() { TileMap m( f,Direction::Up() ); } );
+			const double tRmz = TimeLoads( nRepeats,[&]() { TileMap m( rmzFile,Direction::Up() ); } );
+			std::cout << f << " (" << map.GetGridWidth() << "x" << map.GetGridHeight() << ")"
+				<< ": reference " << tRef << "us, text " << tText << "us (x" << tRef / tText
+				<< "), rmz " << tRmz << "us" << (match ? "" : "  MISMATCH") << std::endl;
+		}
+		std::remove( rmzFile.c_str() );
+		if( !allMatch )
+		{
+			std::cerr << "robomaze_loadbench: loaders disagree" << std::endl;
+			return 1;
+		}
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_loadbench: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
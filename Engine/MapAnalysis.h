@@ -0,0 +1,273 @@
+#pragma once
+
+#include "TileMap.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+// whole map facts that do not depend on the robot: the breadth first distance of
+// every cell to the nearest goal, the connected open areas, the shortest path
+// from the start and the number of dead ends
+// file maps get theirs through Get(), once per process and cached on disk in a
+// sidecar next to the map (<map file>.rma), keyed by the map's content hash so an
+// edited map is analysed again
+class MapAnalysis
+{
+public:
+	explicit MapAnalysis( const TileMap& map )
+		:
+		hash( map.GetContentHash() ),
+		goalDistance( map.GetGridWidth(),map.GetGridHeight(),unreachable,wall )
+	{
+		const int width = map.GetGridWidth();
+		const int height = map.GetGridHeight();
+		// walls are marked in the distance grid itself, so the searches below only
+		// ever look at one padded grid and never bounds check
+		std::vector<size_t> frontier;
+		for( int y = 0; y < height; y++ )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				const auto type = map.At( { x,y } );
+				if( type == TileMap::TileType::Goal )
+				{
+					goalDistance.At( x,y ) = 0;
+					frontier.push_back( goalDistance.GetIndex( x,y ) );
+				}
+				else if( type != TileMap::TileType::Floor )
+				{
+					goalDistance.At( x,y ) = wall;
+				}
+			}
+		}
+		// distances, level by level from all goals at once
+		std::vector<size_t> next;
+		for( int d = 1; !frontier.empty(); d++ )
+		{
+			next.clear();
+			for( const auto i : frontier )
+			{
+				goalDistance.VisitNeighborIndices( i,[&]( size_t n )
+				{
+					if( goalDistance[n] == unreachable )
+					{
+						goalDistance[n] = d;
+						next.push_back( n );
+					}
+				} );
+			}
+			frontier.swap( next );
+		}
+		optimalPathLength = goalDistance.At( map.GetStartPos() );
+
+		// components and dead ends, one flood fill per open area not seen yet
+		Grid<char> seen( width,height,0,1 );
+		for( int y = 0; y < height; y++ )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				const auto index = goalDistance.GetIndex( x,y );
+				if( goalDistance[index] == wall )
+				{
+					continue;
+				}
+				int nOpen = 0;
+				goalDistance.VisitNeighborIndices( index,[&]( size_t n )
+				{
+					nOpen += int( goalDistance[n] != wall );
+				} );
+				nDeadEnds += int( nOpen == 1 );
+				if( seen.At( x,y ) )
+				{
+					continue;
+				}
+				nComponents++;
+				// both grids are padded the same way, so indices carry over
+				int size = 0;
+				frontier.assign( 1,index );
+				seen[index] = 1;
+				while( !frontier.empty() )
+				{
+					const auto i = frontier.back();
+					frontier.pop_back();
+					size++;
+					goalDistance.VisitNeighborIndices( i,[&]( size_t n )
+					{
+						if( !seen[n] && goalDistance[n] != wall )
+						{
+							seen[n] = 1;
+							frontier.push_back( n );
+						}
+					} );
+				}
+				if( seen.At( map.GetStartPos() ) && startComponentSize == 0 )
+				{
+					startComponentSize = size;
+				}
+			}
+		}
+	}
+	// analysis of a file map, from the process wide cache, else its sidecar,
+	// else computed (and the sidecar written, failing to write it is not an error)
+	static std::shared_ptr<const MapAnalysis> Get( const TileMap& map,const std::string& mapFilename )
+	{
+		static std::mutex mutex;
+		static std::unordered_map<uint64_t,std::shared_ptr<const MapAnalysis>> cache;
+
+		const auto hash = map.GetContentHash();
+		std::lock_guard<std::mutex> lock( mutex );
+		auto& pAnalysis = cache[hash];
+		if( !pAnalysis )
+		{
+			const auto sidecar = GetSidecarFilename( mapFilename );
+			auto pLoaded = Load( sidecar,map,hash );
+			if( !pLoaded )
+			{
+				pLoaded = std::make_unique<MapAnalysis>( map );
+				pLoaded->Save( sidecar );
+			}
+			pAnalysis = std::move( pLoaded );
+		}
+		return pAnalysis;
+	}
+	static std::string GetSidecarFilename( const std::string& mapFilename )
+	{
+		return mapFilename + ".rma";
+	}
+	uint64_t GetHash() const
+	{
+		return hash;
+	}
+	// steps from pos to the nearest goal, -1 if no goal can be reached (or pos is a wall)
+	int GetGoalDistance( const Vei2& pos ) const
+	{
+		const int d = goalDistance.At( pos );
+		return d >= 0 ? d : -1;
+	}
+	// goal distance of the start, -1 if the goal cannot be reached
+	int GetOptimalPathLength() const
+	{
+		return optimalPathLength >= 0 ? optimalPathLength : -1;
+	}
+	int GetComponentCount() const
+	{
+		return nComponents;
+	}
+	// open cells reachable from the start (start included)
+	int GetStartComponentSize() const
+	{
+		return startComponentSize;
+	}
+	// open cells with exactly one open neighbor
+	int GetDeadEndCount() const
+	{
+		return nDeadEnds;
+	}
+private:
+	// sidecar layout: this header, then width * height int32 goal distances row by row
+	struct Header
+	{
+		char magic[4];
+		int32_t version;
+		int32_t width;
+		int32_t height;
+		uint64_t hash;
+		int32_t optimalPathLength;
+		int32_t nComponents;
+		int32_t startComponentSize;
+		int32_t nDeadEnds;
+	};
+	static_assert( sizeof( Header ) == 40,"rma header must not have padding" );
+	static constexpr int32_t version = 1;
+	// goal distance grid markers (an enum so binding them to Grid's const T& needs no definition)
+	enum : int
+	{
+		unreachable = -1,
+		wall = -2
+	};
+private:
+	MapAnalysis( const TileMap& map,uint64_t hash )
+		:
+		hash( hash ),
+		goalDistance( map.GetGridWidth(),map.GetGridHeight(),unreachable,wall )
+	{}
+	static const char* GetMagic()
+	{
+		return "RMA\x1a";
+	}
+	// null if the sidecar is missing, damaged or belongs to another version of the map
+	static std::unique_ptr<MapAnalysis> Load( const std::string& filename,const TileMap& map,uint64_t hash )
+	{
+		std::ifstream file( filename,std::ios::binary );
+		Header header;
+		if( !file.read( reinterpret_cast<char*>( &header ),sizeof( header ) ) ||
+			!std::equal( header.magic,header.magic + 4,GetMagic() ) ||
+			header.version != version || header.hash != hash ||
+			header.width != map.GetGridWidth() || header.height != map.GetGridHeight() )
+		{
+			return nullptr;
+		}
+		std::unique_ptr<MapAnalysis> pAnalysis( new MapAnalysis( map,hash ) );
+		pAnalysis->optimalPathLength = header.optimalPathLength;
+		pAnalysis->nComponents = header.nComponents;
+		pAnalysis->startComponentSize = header.startComponentSize;
+		pAnalysis->nDeadEnds = header.nDeadEnds;
+		std::vector<int32_t> row( (size_t)header.width );
+		for( int y = 0; y < header.height; y++ )
+		{
+			if( !file.read( reinterpret_cast<char*>( row.data() ),(std::streamsize)(row.size() * sizeof( int32_t )) ) )
+			{
+				return nullptr;
+			}
+			std::copy( row.begin(),row.end(),&pAnalysis->goalDistance.At( 0,y ) );
+		}
+		return pAnalysis;
+	}
+	// written to a temporary and renamed, so a reader never sees half a sidecar
+	void Save( const std::string& filename ) const
+	{
+		const auto temp = filename + ".tmp";
+		{
+			std::ofstream file( temp,std::ios::binary );
+			Header header;
+			std::copy( GetMagic(),GetMagic() + 4,header.magic );
+			header.version = version;
+			header.width = goalDistance.GetWidth();
+			header.height = goalDistance.GetHeight();
+			header.hash = hash;
+			header.optimalPathLength = optimalPathLength;
+			header.nComponents = nComponents;
+			header.startComponentSize = startComponentSize;
+			header.nDeadEnds = nDeadEnds;
+			file.write( reinterpret_cast<const char*>( &header ),sizeof( header ) );
+			for( int y = 0; y < header.height; y++ )
+			{
+				file.write( reinterpret_cast<const char*>( &goalDistance.At( 0,y ) ),
+					(std::streamsize)(header.width * sizeof( int32_t ))
+				);
+			}
+			if( !file )
+			{
+				file.close();
+				std::remove( temp.c_str() );
+				return;
+			}
+		}
+		std::remove( filename.c_str() );
+		std::rename( temp.c_str(),filename.c_str() );
+	}
+private:
+	uint64_t hash;
+	// padded with walls, unreachable open cells hold -1
+	Grid<int> goalDistance;
+	int optimalPathLength = unreachable;
+	int nComponents = 0;
+	int startComponentSize = 0;
+	int nDeadEnds = 0;
+};
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "TileMap.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+// corpus archive (.rmc): many maps in one file, read by id
+// layout: Header, every map's packed words (the .rmz / PackedGrid::Data() layout)
+// back to back, then an index of count Entry records at indexOffset
+// the index goes last so a writer can stream maps straight from the generator
+// without knowing how many will come
+namespace MapArchiveFormat
+{
+	constexpr char magic[4] = { 'R','M','C','\x1a' };
+	constexpr int32_t version = 1;
+	struct Header
+	{
+		char magic[4];
+		int32_t version;
+		int32_t count;
+		int32_t reserved;
+		uint64_t indexOffset;
+		uint64_t reserved2;
+	};
+	static_assert( sizeof( Header ) == 32,"rmc header must not have padding" );
+	struct Entry
+	{
+		// byte offset of the map's words from the start of the file
+		uint64_t offset;
+		int32_t width;
+		int32_t height;
+		int32_t startX;
+		int32_t startY;
+		// -1 = the reader's choice
+		int32_t startDir;
+		// generator seed, 0 if the map did not come from the generator
+		uint32_t seed;
+	};
+	static_assert( sizeof( Entry ) == 32,"rmc entry must not have padding" );
+}
+
+// read side: the whole archive is mapped once, Get() hands out maps that point
+// straight into the mapping (no open, no parse, no copy per map)
+class MapArchive
+{
+public:
+	explicit MapArchive( const std::string& filename )
+		:
+		file( std::make_shared<const MappedFile>( filename ) )
+	{
+		using namespace MapArchiveFormat;
+		const auto ThrowIfFalse = [&filename]( bool pred,const std::string& msg )
+		{
+			if( !pred )
+			{
+				throw std::runtime_error( "Map archive load error.\nFile: '" + filename + "' " + msg );
+			}
+		};
+		const auto pBytes = static_cast<const char*>( file->GetData() );
+		ThrowIfFalse( file->GetSize() >= sizeof( Header ),"is too short for an rmc header." );
+		const auto& header = *reinterpret_cast<const Header*>( pBytes );
+		ThrowIfFalse( std::equal( std::begin( magic ),std::end( magic ),header.magic ),"is not an rmc archive." );
+		ThrowIfFalse( header.version == version,"has rmc version " + std::to_string( header.version ) +
+			", expected " + std::to_string( version ) + "."
+		);
+		ThrowIfFalse( header.count >= 0 && header.indexOffset % sizeof( uint64_t ) == 0 &&
+			header.indexOffset <= file->GetSize() &&
+			(file->GetSize() - header.indexOffset) / sizeof( Entry ) >= (size_t)header.count,
+			"has an index outside the file."
+		);
+		pEntries = reinterpret_cast<const Entry*>( pBytes + header.indexOffset );
+		count = header.count;
+		// checked once here so Get() can trust every entry
+		for( int id = 0; id < count; id++ )
+		{
+			const auto& e = pEntries[id];
+			const auto where = "entry " + std::to_string( id ) + " ";
+			ThrowIfFalse( e.width > 0 && e.width <= TileMap::maxSideLength &&
+				e.height > 0 && e.height <= TileMap::maxSideLength,where + "has bad dimensions."
+			);
+			ThrowIfFalse( e.startX >= 0 && e.startX < e.width && e.startY >= 0 && e.startY < e.height,
+				where + "has start pos outside the map."
+			);
+			ThrowIfFalse( e.startDir >= -1 && e.startDir < (int)Direction::Type::Count,where + "has bad start direction." );
+			const uint64_t nBytes = (uint64_t)PackedGrid<TileMap::TileType>::GetWordsPerRow( e.width ) *
+				(uint64_t)e.height * sizeof( uint64_t );
+			ThrowIfFalse( e.offset >= sizeof( Header ) && e.offset % sizeof( uint64_t ) == 0 &&
+				e.offset <= header.indexOffset && nBytes <= header.indexOffset - e.offset,
+				where + "has tiles outside the map area."
+			);
+		}
+	}
+	int GetCount() const
+	{
+		return count;
+	}
+	uint32_t GetSeed( int id ) const
+	{
+		return GetEntry( id ).seed;
+	}
+	// sd is only used if the entry has no start direction
+	TileMap Get( int id,const Direction& sd ) const
+	{
+		const auto& e = GetEntry( id );
+		const auto pWords = reinterpret_cast<const uint64_t*>(
+			static_cast<const char*>( file->GetData() ) + e.offset
+		);
+		return TileMap(
+			PackedGrid<TileMap::TileType>( e.width,e.height,pWords,file ),
+			{ e.startX,e.startY },
+			e.startDir != -1 ? Direction( (Direction::Type)e.startDir ) : sd
+		);
+	}
+	static bool IsArchiveFile( const std::string& filename )
+	{
+		const std::string ext = ".rmc";
+		return filename.size() >= ext.size() &&
+			filename.compare( filename.size() - ext.size(),ext.size(),ext ) == 0;
+	}
+	// process wide, each archive is mapped once and shared by every simulation
+	static std::shared_ptr<const MapArchive> Open( const std::string& filename )
+	{
+		static std::mutex mutex;
+		static std::unordered_map<std::string,std::shared_ptr<const MapArchive>> archives;
+
+		std::lock_guard<std::mutex> lock( mutex );
+		auto& pArchive = archives[filename];
+		if( !pArchive )
+		{
+			pArchive = std::make_shared<const MapArchive>( filename );
+		}
+		return pArchive;
+	}
+private:
+	const MapArchiveFormat::Entry& GetEntry( int id ) const
+	{
+		if( id < 0 || id >= count )
+		{
+			throw std::runtime_error( "Map archive has no map " + std::to_string( id ) +
+				" (" + std::to_string( count ) + " maps)."
+			);
+		}
+		return pEntries[id];
+	}
+private:
+	std::shared_ptr<const MappedFile> file;
+	const MapArchiveFormat::Entry* pEntries = nullptr;
+	int count = 0;
+};
+
+// write side: maps are appended as they are added, Finish() writes the index
+// and the header (an archive that was never finished does not load)
+class MapArchiveWriter
+{
+public:
+	explicit MapArchiveWriter( const std::string& filename )
+		:
+		filename( filename ),
+		file( filename,std::ios::binary )
+	{
+		if( !file )
+		{
+			throw std::runtime_error( "Map archive save error.\nFile: '" + filename + "' could not be opened." );
+		}
+		// placeholder, the real header goes in once the index offset is known
+		const MapArchiveFormat::Header header = {};
+		file.write( reinterpret_cast<const char*>( &header ),sizeof( header ) );
+		offset = sizeof( header );
+	}
+	MapArchiveWriter( const MapArchiveWriter& ) = delete;
+	MapArchiveWriter& operator=( const MapArchiveWriter& ) = delete;
+	// returns the map's id
+	int Add( const TileMap& map,uint32_t seed = 0u,bool storeStartDir = false )
+	{
+		const auto& tiles = map.GetTiles();
+		const size_t nBytes = (size_t)PackedGrid<TileMap::TileType>::GetWordsPerRow( tiles.GetWidth() ) *
+			tiles.GetHeight() * sizeof( uint64_t );
+		MapArchiveFormat::Entry e;
+		e.offset = offset;
+		e.width = tiles.GetWidth();
+		e.height = tiles.GetHeight();
+		e.startX = map.GetStartPos().x;
+		e.startY = map.GetStartPos().y;
+		e.startDir = storeStartDir ? (int32_t)map.GetStartDirection().GetType() : -1;
+		e.seed = seed;
+		file.write( reinterpret_cast<const char*>( tiles.Data() ),(std::streamsize)nBytes );
+		offset += nBytes;
+		entries.push_back( e );
+		return (int)entries.size() - 1;
+	}
+	void Finish()
+	{
+		MapArchiveFormat::Header header = {};
+		std::copy( std::begin( MapArchiveFormat::magic ),std::end( MapArchiveFormat::magic ),header.magic );
+		header.version = MapArchiveFormat::version;
+		header.count = (int32_t)entries.size();
+		header.indexOffset = offset;
+		file.write( reinterpret_cast<const char*>( entries.data() ),
+			(std::streamsize)(entries.size() * sizeof( MapArchiveFormat::Entry ))
+		);
+		file.seekp( 0 );
+		file.write( reinterpret_cast<const char*>( &header ),sizeof( header ) );
+		file.close();
+		if( !file )
+		{
+			throw std::runtime_error( "Map archive save error.\nFile: '" + filename + "' could not be written." );
+		}
+	}
+	int GetCount() const
+	{
+		return (int)entries.size();
+	}
+private:
+	std::string filename;
+	std::ofstream file;
+	uint64_t offset = 0u;
+	std::vector<MapArchiveFormat::Entry> entries;
+};
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#ifdef _WIN32
+#include "ChiliWin.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+// read-only view of a whole file, mapped into memory instead of read
+// pages are faulted in by the os on first touch and shared with every other
+// process mapping the same file, so opening a big map costs next to nothing
+class MappedFile
+{
+public:
+	explicit MappedFile( const std::string& filename )
+	{
+		// the destructor does not run for a throwing constructor
+		try
+		{
+			Open( filename );
+		}
+		catch( ... )
+		{
+			Close();
+			throw;
+		}
+	}
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+	~MappedFile()
+	{
+		Close();
+	}
+	// start of the file, page aligned (nullptr for an empty file)
+	const void* GetData() const
+	{
+		return pData;
+	}
+	size_t GetSize() const
+	{
+		return size;
+	}
+private:
+	void Open( const std::string& filename )
+	{
+		const auto ThrowIfFalse = [&filename]( bool pred,const std::string& msg )
+		{
+			if( !pred )
+			{
+				throw std::runtime_error( "File: '" + filename + "' " + msg );
+			}
+		};
+#ifdef _WIN32
+		hFile = CreateFileA( filename.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,
+			OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr
+		);
+		ThrowIfFalse( hFile != INVALID_HANDLE_VALUE,"could not be opened." );
+		LARGE_INTEGER fileSize;
+		ThrowIfFalse( GetFileSizeEx( hFile,&fileSize ) != 0,"could not be sized." );
+		size = (size_t)fileSize.QuadPart;
+		if( size > 0u )
+		{
+			hMapping = CreateFileMappingA( hFile,nullptr,PAGE_READONLY,0,0,nullptr );
+			ThrowIfFalse( hMapping != nullptr,"could not be mapped." );
+			pData = MapViewOfFile( hMapping,FILE_MAP_READ,0,0,0 );
+			ThrowIfFalse( pData != nullptr,"could not be mapped." );
+		}
+#else
+		fd = open( filename.c_str(),O_RDONLY );
+		ThrowIfFalse( fd != -1,"could not be opened." );
+		struct stat st;
+		ThrowIfFalse( fstat( fd,&st ) == 0,"could not be sized." );
+		size = (size_t)st.st_size;
+		if( size > 0u )
+		{
+			void* p = mmap( nullptr,size,PROT_READ,MAP_SHARED,fd,0 );
+			ThrowIfFalse( p != MAP_FAILED,"could not be mapped." );
+			pData = p;
+		}
+#endif
+	}
+	void Close()
+	{
+#ifdef _WIN32
+		if( pData != nullptr )
+		{
+			UnmapViewOfFile( pData );
+		}
+		if( hMapping != nullptr )
+		{
+			CloseHandle( hMapping );
+		}
+		if( hFile != INVALID_HANDLE_VALUE )
+		{
+			CloseHandle( hFile );
+		}
+#else
+		if( pData != nullptr )
+		{
+			munmap( const_cast<void*>( pData ),size );
+		}
+		if( fd != -1 )
+		{
+			close( fd );
+		}
+#endif
+	}
+private:
+	const void* pData = nullptr;
+	size_t size = 0u;
+#ifdef _WIN32
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	HANDLE hMapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
\ No newline at end of file
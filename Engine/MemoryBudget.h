@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+// counting semaphore over bytes (and a cap on the number of holders)
+// Acquire blocks until the request fits, but a request is always granted when
+// nothing else is held so a single oversized job cannot deadlock the budget
+class MemoryBudget
+{
+public:
+	// budget of 0 bytes means unlimited
+	MemoryBudget( size_t budget,int maxHolders )
+		:
+		budget( budget ),
+		maxHolders( maxHolders )
+	{}
+	MemoryBudget( const MemoryBudget& ) = delete;
+	MemoryBudget& operator=( const MemoryBudget& ) = delete;
+	// returns false if the budget was aborted while waiting
+	bool Acquire( size_t bytes )
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		cv.wait( lock,[this,bytes]() { return aborted || Fits( bytes ); } );
+		if( aborted )
+		{
+			return false;
+		}
+		used += bytes;
+		nHolders++;
+		return true;
+	}
+	void Release( size_t bytes )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			used -= bytes;
+			nHolders--;
+		}
+		cv.notify_all();
+	}
+	// wakes all waiters and makes every future Acquire fail
+	void Abort()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			aborted = true;
+		}
+		cv.notify_all();
+	}
+	size_t GetBudget() const
+	{
+		return budget;
+	}
+private:
+	bool Fits( size_t bytes ) const
+	{
+		if( nHolders == 0 )
+		{
+			return true;
+		}
+		return nHolders < maxHolders && (budget == 0u || used + bytes <= budget);
+	}
+private:
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t budget;
+	size_t used = 0u;
+	int maxHolders;
+	int nHolders = 0;
+	bool aborted = false;
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "Simulator.h"
+#include "Config.h"
+#include "Histogram.h"
+#include "TscClock.h"
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <memory>
+#include <cstdint>
+
+// appends one record per finished run as it arrives (flushed, so a crash keeps
+// everything written so far) and keeps only fixed size aggregates for the summary
+class ResultsWriter
+{
+public:
+	enum class Format
+	{
+		Text,
+		Csv,
+		JsonLines,
+		Count
+	};
+	struct Record
+	{
+		int index;
+		unsigned int seed;
+		int width;
+		int height;
+		// Count for file maps (goal comes from the map)
+		Config::GoalMode goalMode;
+		int nMoves;
+		float time;
+		int nReplans;
+		Simulator::State result;
+		// per Plan() call latency in TscClock ticks
+		Histogram planLatency;
+	};
+public:
+	ResultsWriter( const std::string& filename,Format format,unsigned int masterSeed )
+		:
+		pFile( std::make_unique<std::ofstream>( filename ) ),
+		out( *pFile ),
+		format( format )
+	{
+		WriteHeader( masterSeed );
+	}
+	ResultsWriter( std::ostream& out,Format format,unsigned int masterSeed )
+		:
+		out( out ),
+		format( format )
+	{
+		WriteHeader( masterSeed );
+	}
+	ResultsWriter( const ResultsWriter& ) = delete;
+	ResultsWriter& operator=( const ResultsWriter& ) = delete;
+	void Write( const Record& r )
+	{
+		moves.Record( (uint64_t)r.nMoves );
+		times.Record( ToNanoseconds( r.time ) );
+		planLatency.Merge( r.planLatency );
+		const double nsPerTick = TscClock::GetSecondsPerTick() * 1e9;
+		if( r.result == Simulator::State::Success )
+		{
+			nSuccess++;
+		}
+		switch( format )
+		{
+		case Format::Text:
+			out << std::endl << " [" << r.seed << "]\n";
+			out << "Result: " << ((r.result == Simulator::State::Success) ? "Success\n" : "Failure\n");
+			out << "Moves taken:" << r.nMoves << std::endl;
+			out << "Time taken:" << r.time << std::endl;
+			out << "Plan latency p50/p99/p99.9/max (ns):";
+			WriteLatency( r.planLatency,nsPerTick,"/" );
+			out << std::endl;
+			break;
+		case Format::Csv:
+			out << r.index << ',' << r.seed << ',' << r.width << ',' << r.height << ','
+				<< GetGoalModeName( r.goalMode ) << ',' << r.nMoves << ',' << r.time << ','
+				<< r.nReplans << ',' << GetStateName( r.result ) << ',';
+			WriteLatency( r.planLatency,nsPerTick,"," );
+			out << std::endl;
+			break;
+		case Format::JsonLines:
+			out << "{\"index\":" << r.index
+				<< ",\"seed\":" << r.seed
+				<< ",\"width\":" << r.width
+				<< ",\"height\":" << r.height
+				<< ",\"goal_mode\":\"" << GetGoalModeName( r.goalMode ) << '"'
+				<< ",\"moves\":" << r.nMoves
+				<< ",\"plan_time\":" << r.time
+				<< ",\"replans\":" << r.nReplans
+				<< ",\"result\":\"" << GetStateName( r.result ) << '"'
+				<< ",\"plan_latency_ns\":";
+			WriteLatencyJson( r.planLatency,nsPerTick );
+			out << "}" << std::endl;
+			break;
+		default:
+			assert( "Bad results format" && false );
+		}
+	}
+	// totals and aggregate statistics, call once after the last record
+	void Finish()
+	{
+		const double nsPerTick = TscClock::GetSecondsPerTick() * 1e9;
+		switch( format )
+		{
+		case Format::Text:
+			out << std::endl << std::endl
+				<< "========================================\n"
+				<< "Success Rate: " << nSuccess << "/" << moves.GetCount() << std::endl
+				<< "Total Moves: " << (uint64_t)moves.GetSum() << std::endl
+				<< "Total Time: " << (float)(times.GetSum() * 1e-9) << std::endl
+				<< "Moves mean/p50/p95/p99/max: ";
+			WriteStats( moves,1.0,"/" );
+			out << std::endl << "Time  mean/p50/p95/p99/max: ";
+			WriteStats( times,1e-9,"/" );
+			out << std::endl << "Plan latency p50/p99/p99.9/max (ns):";
+			WriteLatency( planLatency,nsPerTick,"/" );
+			out << std::endl;
+			break;
+		case Format::Csv:
+			// trailing comment lines so the record table stays a plain csv
+			out << "# runs," << moves.GetCount() << ",success," << nSuccess << std::endl
+				<< "# stat,mean,p50,p95,p99,max" << std::endl
+				<< "# moves,";
+			WriteStats( moves,1.0,"," );
+			out << std::endl << "# plan_time,";
+			WriteStats( times,1e-9,"," );
+			out << std::endl << "# stat,p50,p99,p99.9,max" << std::endl
+				<< "# plan_latency_ns,";
+			WriteLatency( planLatency,nsPerTick,"," );
+			out << std::endl;
+			break;
+		case Format::JsonLines:
+			out << "{\"summary\":true,\"runs\":" << moves.GetCount()
+				<< ",\"success\":" << nSuccess
+				<< ",\"moves\":";
+			WriteStatsJson( moves,1.0 );
+			out << ",\"plan_time\":";
+			WriteStatsJson( times,1e-9 );
+			out << ",\"plan_latency_ns\":";
+			WriteLatencyJson( planLatency,nsPerTick );
+			out << "}" << std::endl;
+			break;
+		default:
+			assert( "Bad results format" && false );
+		}
+	}
+	static const char* GetGoalModeName( Config::GoalMode mode )
+	{
+		switch( mode )
+		{
+		case Config::GoalMode::NoGoal:
+			return "none";
+		case Config::GoalMode::Random:
+			return "random";
+		case Config::GoalMode::RoomCenter:
+			return "room_center";
+		case Config::GoalMode::StartPosition:
+			return "start";
+		case Config::GoalMode::InView:
+			return "in_view";
+		default:
+			return "file";
+		}
+	}
+	static const char* GetStateName( Simulator::State state )
+	{
+		switch( state )
+		{
+		case Simulator::State::Success:
+			return "success";
+		case Simulator::State::Failure:
+			return "failure";
+		default:
+			return "working";
+		}
+	}
+private:
+	void WriteHeader( unsigned int masterSeed )
+	{
+		switch( format )
+		{
+		case Format::Text:
+			out << "  Master seed: [" << masterSeed << "]\n" <<
+				"=========================================" << std::endl;
+			break;
+		case Format::Csv:
+			out << "# master_seed," << masterSeed << std::endl
+				<< "index,seed,width,height,goal_mode,moves,plan_time,replans,result,"
+				<< "plan_p50_ns,plan_p99_ns,plan_p999_ns,plan_max_ns" << std::endl;
+			break;
+		case Format::JsonLines:
+			break;
+		default:
+			assert( "Bad results format" && false );
+		}
+	}
+	void WriteStats( const Histogram& h,double scale,const char* sep )
+	{
+		out << h.GetMean() * scale << sep
+			<< h.GetPercentile( 50.0 ) * scale << sep
+			<< h.GetPercentile( 95.0 ) * scale << sep
+			<< h.GetPercentile( 99.0 ) * scale << sep
+			<< h.GetMax() * scale;
+	}
+	void WriteStatsJson( const Histogram& h,double scale )
+	{
+		out << "{\"mean\":" << h.GetMean() * scale
+			<< ",\"p50\":" << h.GetPercentile( 50.0 ) * scale
+			<< ",\"p95\":" << h.GetPercentile( 95.0 ) * scale
+			<< ",\"p99\":" << h.GetPercentile( 99.0 ) * scale
+			<< ",\"max\":" << h.GetMax() * scale << "}";
+	}
+	void WriteLatency( const Histogram& h,double nsPerTick,const char* sep )
+	{
+		out << (uint64_t)(h.GetPercentile( 50.0 ) * nsPerTick) << sep
+			<< (uint64_t)(h.GetPercentile( 99.0 ) * nsPerTick) << sep
+			<< (uint64_t)(h.GetPercentile( 99.9 ) * nsPerTick) << sep
+			<< (uint64_t)(h.GetMax() * nsPerTick);
+	}
+	void WriteLatencyJson( const Histogram& h,double nsPerTick )
+	{
+		out << "{\"p50\":" << (uint64_t)(h.GetPercentile( 50.0 ) * nsPerTick)
+			<< ",\"p99\":" << (uint64_t)(h.GetPercentile( 99.0 ) * nsPerTick)
+			<< ",\"p99.9\":" << (uint64_t)(h.GetPercentile( 99.9 ) * nsPerTick)
+			<< ",\"max\":" << (uint64_t)(h.GetMax() * nsPerTick) << "}";
+	}
+	static uint64_t ToNanoseconds( float seconds )
+	{
+		return (uint64_t)((double)seconds * 1e9 + 0.5);
+	}
+private:
+	std::unique_ptr<std::ofstream> pFile;
+	std::ostream& out;
+	Format format;
+	int nSuccess = 0;
+	Histogram moves;
+	Histogram times;
+	// merged across all runs
+	Histogram planLatency;
+};
@@ -0,0 +1,83 @@
+// converts maps between the text format (#/./%) and the binary .rmz format
+// usage: robomaze_rmz <in> <out> [direction]
+// the format of each side follows its extension (.rmz binary, anything else text)
+// direction (0=up 1=down 2=left 3=right) is stored in the .rmz header, without it
+// the loader keeps picking the start direction as before; text maps have no
+// start direction, so it is dropped going back to text
+// usage: robomaze_rmz --corpus <ini> <out.rmc> <count>
+// fills a corpus archive straight from the generator: map n is the map the
+// evaluator would generate for run n of the ini's master seed (the stress run
+// aside), so an ini pointed at the archive sweeps the same mazes without
+// generating them again
+#include "TileMap.h"
+#include "MapArchive.h"
+#include "Evaluator.h"
+#include <iostream>
+#include <exception>
+#include <string>
+#include <random>
+
+int MakeCorpus( const std::string& iniFilename,const std::string& outFilename,int count )
+{
+	const Config config( iniFilename );
+	if( config.GetMapMode() != Config::MapMode::Procedural )
+	{
+		throw std::runtime_error( "'" + iniFilename + "' does not use procedural maps (map_mode=1)." );
+	}
+	MapArchiveWriter archive( outFilename );
+	std::mt19937 seed_gen( config.GetSeed() );
+	for( int n = 0; n < count; n++ )
+	{
+		const auto s = seed_gen();
+		std::mt19937 rng( s );
+		archive.Add( TileMap( Evaluator::GenerateConfig( config,s ),rng ),s,true );
+	}
+	archive.Finish();
+	std::cout << count << " maps -> " << outFilename << std::endl;
+	return 0;
+}
+
+int main( int argc,char* argv[] )
+{
+	if( argc < 3 )
+	{
+		std::cerr << "usage: robomaze_rmz <in> <out> [direction]" << std::endl;
+		std::cerr << "       robomaze_rmz --corpus <ini> <out.rmc> <count>" << std::endl;
+		return 2;
+	}
+	try
+	{
+		if( std::string( argv[1] ) == "--corpus" )
+		{
+			if( argc < 5 )
+			{
+				std::cerr << "usage: robomaze_rmz --corpus <ini> <out.rmc> <count>" << std::endl;
+				return 2;
+			}
+			return MakeCorpus( argv[2],argv[3],std::stoi( argv[4] ) );
+		}
+		const bool storeStartDir = argc > 3;
+		const int dir = storeStartDir ? std::stoi( argv[3] ) : 0;
+		if( dir < 0 || dir >= (int)Direction::Type::Count )
+		{
+			throw std::runtime_error( "Bad direction: " + std::string( argv[3] ) );
+		}
+		const TileMap map( argv[1],(Direction::Type)dir );
+		if( TileMap::IsBinaryMapFile( argv[2] ) )
+		{
+			map.SaveBinary( argv[2],storeStartDir );
+		}
+		else
+		{
+			map.Save( argv[2] );
+		}
+		std::cout << argv[1] << " -> " << argv[2] << " (" << map.GetGridWidth() << "x"
+			<< map.GetGridHeight() << ")" << std::endl;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_rmz: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "Direction.h"
 #include <random>
 #include <array>
+#include <vector>
 #include <cassert>
 
 class Robo
@@ -21,15 +22,7 @@ public:
 		:
 		pos( pos ),
 		dir( dir )
-	{
-		sprites.reserve( (int)Direction::Type::Count );
-		for( int i = 0; i < (int)Direction::Type::Count; i++ )
-		{
-			sprites.emplace_back( "Images\\robo_" + 
-				Direction( (Direction::Type)i ).GetName() + ".bmp" );
-		}
-		offset_to_center = { sprites.front().GetWidth() / 2,sprites.front().GetHeight() / 2 };
-	}
+	{}
 	void MoveForward( const TileMap& map )
 	{
 		const auto target = pos + dir;
@@ -66,15 +59,20 @@ public:
 			assert( "Bad action type in take action" && false );
 		}
 	}
+#ifndef ROBOMAZE_HEADLESS
 	void Draw( Graphics& gfx,const Camera& cam,const Viewport& port,const TileMap& map ) const
 	{
+		// sprites are shared through the asset cache, loaded on first draw
+		const auto& surf = Assets::GetSurface( "Images/robo_" + dir.GetName() + ".bmp" );
+		// graphical offset from top left of sprite to center
+		const Vei2 offset_to_center = { surf.GetWidth() / 2,surf.GetHeight() / 2 };
 		const auto center_in_world = map.GetCenterAt( pos );
 		const auto draw_pos = (Vei2)cam.GetTranslatedPoint( center_in_world ) - offset_to_center;
-		const auto& surf = sprites[dir.GetIndex()];
 		gfx.DrawSprite( draw_pos.x,draw_pos.y,surf.GetRect(),port.GetClipRect(),surf,
 			SpriteEffect::Chroma{ Colors::Black }
 		);
 	}
+#endif
 	std::array<TileMap::TileType,3> GetView( const TileMap& map ) const
 	{
 		auto scan_pos = pos + dir + dir.GetRotatedCounterClockwise();
@@ -98,8 +96,4 @@ public:
 private:
 	Vei2 pos;
 	Direction dir;
-	// graphical offset from top left of sprite to center
-	Vei2 offset_to_center;
-	// up down left right
-	std::vector<Surface> sprites;
 };
\ No newline at end of file
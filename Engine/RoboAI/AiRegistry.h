@@ -0,0 +1,112 @@
+#pragma once
+
+#include "RoboAI.h"
+#include "CoroutineAI.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+// tag used to hand an ai type to a generic lambda
+template<typename T>
+struct AiTag
+{
+	typedef T Type;
+};
+
+// every ai a single binary can run, selected at runtime by name (config key 'ai')
+// add new ais here next to the RoboAI typedef
+template<typename Visitor>
+void VisitRegisteredAIs( Visitor&& visit )
+{
+	visit( "rvdw",AiTag<RoboAI_rvdw>{} );
+	visit( "rvdw2",AiTag<RoboAI_rvdw2>{} );
+	visit( "chili",AiTag<RoboAI_chili>{} );
+#if defined( __cpp_impl_coroutine )
+	visit( "dfs",AiTag<RoboAI_dfs>{} );
+#endif
+}
+
+// owns one ai instance and drives Runner::StepWith<AI>() with it
+// the virtual call happens once per slice of moves, the step loop itself is
+// instantiated per ai type so Plan() is a direct (inlinable) call on every move
+template<typename Runner>
+class AiStepper
+{
+public:
+	virtual ~AiStepper() = default;
+	// runs at most maxMoves moves, returns true while the runner needs more
+	virtual bool Step( Runner& runner,int maxMoves ) = 0;
+	virtual int GetReplanCount() const = 0;
+};
+
+template<typename Runner,typename AI>
+class AiStepperT : public AiStepper<Runner>
+{
+public:
+	bool Step( Runner& runner,int maxMoves ) override
+	{
+		return runner.StepWith( ai,maxMoves );
+	}
+	int GetReplanCount() const override
+	{
+		return ai.GetReplanCount();
+	}
+private:
+	AI ai;
+};
+
+// maps ai names onto stepper factories, looked up once per simulation
+template<typename Runner>
+class AiRegistry
+{
+public:
+	typedef std::unique_ptr<AiStepper<Runner>>( *MakeFunc )();
+	struct Entry
+	{
+		std::string name;
+		MakeFunc make;
+	};
+public:
+	static const std::vector<Entry>& GetEntries()
+	{
+		static const std::vector<Entry> entries = Build();
+		return entries;
+	}
+	// empty name selects the default RoboAI typedef
+	static MakeFunc Find( const std::string& name )
+	{
+		if( name.empty() )
+		{
+			return &Make<RoboAI>;
+		}
+		for( const auto& e : GetEntries() )
+		{
+			if( e.name == name )
+			{
+				return e.make;
+			}
+		}
+		std::string known;
+		for( const auto& e : GetEntries() )
+		{
+			known += " " + e.name;
+		}
+		throw std::runtime_error( "Unknown ai '" + name + "', registered:" + known );
+	}
+private:
+	static std::vector<Entry> Build()
+	{
+		std::vector<Entry> entries;
+		VisitRegisteredAIs( [&entries]( const char* name,auto tag )
+		{
+			entries.push_back( { name,&Make<typename decltype(tag)::Type> } );
+		} );
+		return entries;
+	}
+	template<typename AI>
+	static std::unique_ptr<AiStepper<Runner>> Make()
+	{
+		return std::make_unique<AiStepperT<Runner,AI>>();
+	}
+};
\ No newline at end of file
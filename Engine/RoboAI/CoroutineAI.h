@@ -0,0 +1,253 @@
+#pragma once
+
+// planners written as c++20 coroutines: the planner body is one straight line of
+// code that co_yields an action and gets the next view back, instead of a Plan()
+// state machine that has to remember where it was between calls
+#if defined( __cpp_impl_coroutine )
+#include "../Robo.h"
+#include <coroutine>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+class PlanTask
+{
+public:
+	typedef std::array<TileMap::TileType,3> View;
+	// co_await PlanTask::NextView{} reads the view handed to the current Plan() call
+	struct NextView
+	{};
+	struct promise_type;
+	struct ViewAwaiter
+	{
+		bool await_ready() const noexcept
+		{
+			return !suspend;
+		}
+		void await_suspend( std::coroutine_handle<promise_type> ) const noexcept
+		{}
+		View await_resume() const noexcept
+		{
+			return promise.view;
+		}
+		promise_type& promise;
+		bool suspend;
+	};
+	struct promise_type
+	{
+		PlanTask get_return_object()
+		{
+			return PlanTask( std::coroutine_handle<promise_type>::from_promise( *this ) );
+		}
+		// body only starts running on the first Plan()
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+		// co_yield action: hands the action out and resumes with the next view
+		ViewAwaiter yield_value( Robo::Action a ) noexcept
+		{
+			action = a;
+			return { *this,true };
+		}
+		ViewAwaiter await_transform( NextView ) noexcept
+		{
+			return { *this,false };
+		}
+		void return_void() noexcept
+		{}
+		void unhandled_exception()
+		{
+			// surfaces in whoever called Plan()
+			throw;
+		}
+		View view;
+		Robo::Action action = Robo::Action::Done;
+	};
+public:
+	PlanTask( const PlanTask& ) = delete;
+	PlanTask& operator=( const PlanTask& ) = delete;
+	PlanTask( PlanTask&& donor ) noexcept
+		:
+		handle( donor.handle )
+	{
+		donor.handle = nullptr;
+	}
+	~PlanTask()
+	{
+		if( handle )
+		{
+			handle.destroy();
+		}
+	}
+	// runs the body up to its next co_yield, returns Done once the body has returned
+	Robo::Action Resume( const View& view )
+	{
+		if( handle.done() )
+		{
+			return Robo::Action::Done;
+		}
+		auto& promise = handle.promise();
+		promise.view = view;
+		promise.action = Robo::Action::Done;
+		handle.resume();
+		return promise.action;
+	}
+private:
+	explicit PlanTask( std::coroutine_handle<promise_type> handle )
+		:
+		handle( handle )
+	{}
+private:
+	std::coroutine_handle<promise_type> handle;
+};
+
+// adapts a planner with a 'PlanTask Run()' coroutine to the usual Plan() interface,
+// so it drops into the ai registry / simulators like any other ai
+// the coroutine frame lives on the heap and holds the planner's whole control state
+template<typename Planner>
+class CoroutineAI
+{
+public:
+	CoroutineAI()
+		:
+		task( planner.Run() )
+	{}
+	CoroutineAI( const CoroutineAI& ) = delete;
+	CoroutineAI& operator=( const CoroutineAI& ) = delete;
+	Robo::Action Plan( std::array<TileMap::TileType,3> view )
+	{
+		return task.Resume( view );
+	}
+	int GetReplanCount() const
+	{
+		return planner.GetReplanCount();
+	}
+private:
+	// task refers to planner, so planner is declared (constructed) first
+	Planner planner;
+	PlanTask task;
+};
+
+// depth first explorer: walks every reachable cell once, backtracking along the
+// way it came, and stops on the goal (or when nothing is left to explore)
+// positions are relative to the start, which is (0,0) facing up
+class Planner_dfs
+{
+	using TT = TileMap::TileType;
+	using Action = Robo::Action;
+public:
+	PlanTask Run()
+	{
+		Record( co_await PlanTask::NextView{} );
+		std::vector<Vei2> trail = { pos };
+		visited.insert( Key( pos ) );
+		while( !trail.empty() )
+		{
+			// forward first, then sideways, so exploring costs as few turns as possible
+			const Vei2 candidates[] = { dir,Left( dir ),Right( dir ),-dir };
+			bool advanced = false;
+			for( const auto& d : candidates )
+			{
+				const auto target = pos + d;
+				if( visited.count( Key( target ) ) || Known( target ) == TT::Wall )
+				{
+					continue;
+				}
+				// facing the cell is what reveals it
+				while( dir != d )
+				{
+					const auto a = d == Left( dir ) ? Action::TurnLeft : Action::TurnRight;
+					dir = a == Action::TurnLeft ? Left( dir ) : Right( dir );
+					Record( co_yield a );
+				}
+				const auto type = Known( target );
+				if( type == TT::Wall )
+				{
+					continue;
+				}
+				pos = target;
+				visited.insert( Key( pos ) );
+				if( type == TT::Goal )
+				{
+					co_yield Action::MoveForward;
+					co_yield Action::Done;
+					co_return;
+				}
+				trail.push_back( pos );
+				Record( co_yield Action::MoveForward );
+				advanced = true;
+				break;
+			}
+			if( advanced )
+			{
+				continue;
+			}
+			// dead end, step back the way we came
+			trail.pop_back();
+			if( trail.empty() )
+			{
+				break;
+			}
+			nReplans++;
+			const auto back = trail.back() - pos;
+			while( dir != back )
+			{
+				const auto a = back == Left( dir ) ? Action::TurnLeft : Action::TurnRight;
+				dir = a == Action::TurnLeft ? Left( dir ) : Right( dir );
+				Record( co_yield a );
+			}
+			pos = trail.back();
+			Record( co_yield Action::MoveForward );
+		}
+		// explored everything reachable without seeing a goal
+		co_yield Action::Done;
+	}
+	// number of backtracking steps (for evaluation stats)
+	int GetReplanCount() const
+	{
+		return nReplans;
+	}
+private:
+	// screen coordinates (y down)
+	static Vei2 Left( const Vei2& d )
+	{
+		return { d.y,-d.x };
+	}
+	static Vei2 Right( const Vei2& d )
+	{
+		return { -d.y,d.x };
+	}
+	static uint64_t Key( const Vei2& p )
+	{
+		return (uint64_t( uint32_t( p.x ) ) << 32) | uint32_t( p.y );
+	}
+	TT Known( const Vei2& p ) const
+	{
+		const auto i = known.find( Key( p ) );
+		return i != known.end() ? i->second : TT::Invalid;
+	}
+	// view is front left, front, front right
+	void Record( const PlanTask::View& view )
+	{
+		const auto ahead = pos + dir;
+		known[Key( ahead + Left( dir ) )] = view[0];
+		known[Key( ahead )] = view[1];
+		known[Key( ahead + Right( dir ) )] = view[2];
+	}
+private:
+	Vei2 pos = { 0,0 };
+	Vei2 dir = { 0,-1 };
+	std::unordered_map<uint64_t,TT> known;
+	std::unordered_set<uint64_t> visited;
+	int nReplans = 0;
+};
+
+typedef CoroutineAI<Planner_dfs> RoboAI_dfs;
+#endif
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
-#include "..\Robo.h"
-#include "..\DebugControls.h"
+#include "../Robo.h"
+#include "../DebugControls.h"
 #include <random>
 #include <deque>
 #include <stack>
@@ -86,6 +86,11 @@ public:
 	std::queue<Robo::Action> ReturnFromSquareDanceQueue;
 	//static constexpr bool implemented = false;
 	int lastPos = 0;
+	// number of times the plan had to backtrack (for evaluation stats)
+	int GetReplanCount() const
+	{
+		return nReplans;
+	}
 	Action Plan(std::array<TT, 3> view)
 	{
 		RecordFieldView(view);
@@ -156,6 +161,7 @@ public:
 		}
 		else //backtrack
 		{
+			nReplans++;
 			RoboDir shadowDir = roboPosDir.dir;
 			if (path.size() == 0)
 			{
@@ -312,7 +318,7 @@ private: //Field info
 		}
 		return RoboDir::count;
 	}
-	static constexpr int maxFieldSideLength = 1004;
+	static constexpr int maxFieldSideLength = TileMap::maxSideLength + 4;
 	static constexpr int fieldWidth = 2 * maxFieldSideLength + 1;
 	static constexpr int fieldHeight = fieldWidth;
 	static constexpr int nField = fieldWidth * fieldHeight;
@@ -470,6 +476,7 @@ private: //Exploration control
 	std::unordered_set<int> visited;
 	std::vector<RoboPosDir> path;
 	std::queue<Action> instructionQueue;
+	int nReplans = 0;
 };
 class RoboAI_chili
 {
@@ -518,7 +525,7 @@ public:
 public:
 	RoboAI_chili()
 		:
-		nodes(gridWidth* gridHeight),
+		nodes(gridWidth, gridHeight),
 		pos(gridWidth / 2, gridHeight / 2), // start in middle
 		visit_extent(-1, -1, -1, -1)
 	{
@@ -528,6 +535,11 @@ public:
 	}
 	// this signals to the system whether the debug AI can be used
 	static constexpr bool implemented = true;
+	// number of path recomputations (for evaluation stats)
+	int GetReplanCount() const
+	{
+		return nReplans;
+	}
 	Action Plan(std::array<TT, 3> view)
 	{
 		// return DONE if standing on the goal
@@ -541,6 +553,7 @@ public:
 		if (At(path.back()).GetType() != TT::Invalid)
 		{
 			// compute new path
+			nReplans++;
 			if (!ComputePath())
 			{
 				// if ComputePath() returns false, impossible to reach goal
@@ -582,10 +595,9 @@ private:
 			const auto base = frontier.front();
 			frontier.pop_front();
 
-			auto dir = Direction::Up();
-			for (int i = 0; i < 4; i++, dir.RotateClockwise())
+			for (int i = 0; i < 4; i++)
 			{
-				const auto nodePos = base + dir;
+				const Vei2 nodePos = { base.x + neighborDx[i], base.y + neighborDy[i] };
 				auto& node = At(nodePos);
 				if (node.GetType() == TT::Invalid || node.GetType() == TT::Goal)
 				{
@@ -636,7 +648,7 @@ private:
 	}
 	Node& At(const Vei2& pos)
 	{
-		return nodes[pos.x + pos.y * gridWidth];
+		return nodes.At(pos);
 	}
 	Action MoveTo(const Vei2& target)
 	{
@@ -671,14 +683,17 @@ private:
 private:
 	// grid dimensions 2x the max dimensions
 	// (because we don't know where we start!)
-	static constexpr int gridWidth = 2000;
-	static constexpr int gridHeight = 2000;
+	// nodes and their page table rows are paged in as the robot explores, up
+	// front this is just one empty row per 64 map rows (512 of them, ~12 KB)
+	static constexpr int gridWidth = 2 * TileMap::maxSideLength;
+	static constexpr int gridHeight = 2 * TileMap::maxSideLength;
 	Vei2 pos;
 	std::vector<Vei2> path;
 	Direction dir = Direction::Up();
-	std::vector<Node> nodes;
+	ChunkedGrid<Node> nodes;
 	// inclusive!
 	RectI visit_extent;
+	int nReplans = 0;
 };
 // Debug  / visualization classes
 class RoboAIDebug_rvdw
@@ -941,7 +956,7 @@ private: //Field info
 		}
 		return RoboDir::count;
 	}
-	static constexpr int maxFieldSideLength = 1004;
+	static constexpr int maxFieldSideLength = TileMap::maxSideLength + 4;
 	static constexpr int fieldWidth = 2 * maxFieldSideLength + 1;
 	static constexpr int fieldHeight = fieldWidth;
 	static constexpr int nField = fieldWidth * fieldHeight;
@@ -1148,7 +1163,7 @@ public:
 public:
 	RoboAIDebug_chili(DebugControls& dc)
 		:
-		nodes(gridWidth* gridHeight),
+		nodes(gridWidth, gridHeight),
 		pos(gridWidth / 2, gridHeight / 2), // start in middle
 		dc(dc),
 		angle(GetAngleBetween(dir, dc.GetRobotDirection())),
@@ -1221,10 +1236,9 @@ private:
 			const auto base = frontier.front();
 			frontier.pop_front();
 
-			auto dir = Direction::Up();
-			for (int i = 0; i < 4; i++, dir.RotateClockwise())
+			for (int i = 0; i < 4; i++)
 			{
-				const auto nodePos = base + dir;
+				const Vei2 nodePos = { base.x + neighborDx[i], base.y + neighborDy[i] };
 				auto& node = At(nodePos);
 				if (node.GetType() == TT::Invalid || node.GetType() == TT::Goal)
 				{
@@ -1285,7 +1299,7 @@ private:
 	}
 	Node& At(const Vei2& pos)
 	{
-		return nodes[pos.x + pos.y * gridWidth];
+		return nodes.At(pos);
 	}
 	Action MoveTo(const Vei2& target)
 	{
@@ -1349,12 +1363,14 @@ private:
 	bool visual_init_done = false;
 	// grid dimensions 2x the max dimensions
 	// (because we don't know where we start!)
-	static constexpr int gridWidth = 2000;
-	static constexpr int gridHeight = 2000;
+	// nodes and their page table rows are paged in as the robot explores, up
+	// front this is just one empty row per 64 map rows (512 of them, ~12 KB)
+	static constexpr int gridWidth = 2 * TileMap::maxSideLength;
+	static constexpr int gridHeight = 2 * TileMap::maxSideLength;
 	Vei2 pos;
 	std::vector<Vei2> path;
 	Direction dir = Direction::Up();
-	std::vector<Node> nodes;
+	ChunkedGrid<Node> nodes;
 	int angle;
 	// inclusive!
 	RectI visit_extent;
@@ -1438,6 +1454,7 @@ public:
 		}
 		else
 		{
+			nReplans++;
 			std::vector<size_t> path = Shadow_GetPathToNearestUnexplored();
 			if (path.size() == 0) return Robo::Action::Done;
 			BuildInstructions(path);
@@ -1450,6 +1467,11 @@ public:
 	int SquareDanceToggle = 1;
 	std::queue<Robo::Action> ReturnFromSquareDanceQueue;
 	//static constexpr bool implemented = true;
+	// number of bfs searches for the nearest unexplored cell (for evaluation stats)
+	int GetReplanCount() const
+	{
+		return nReplans;
+	}
 	Robo::Action ProcessInstruction()
 	{
 		//lastPos = roboPosDir.posIndex;
@@ -1703,7 +1725,7 @@ public:
 		}
 	}
 private:
-	static constexpr size_t maxFieldSideLength = 1002;
+	static constexpr size_t maxFieldSideLength = TileMap::maxSideLength + 2;
 	static constexpr size_t fieldWidth = 2 * maxFieldSideLength + 1;
 	static constexpr size_t fieldHeight = fieldWidth;
 	static constexpr size_t fieldSize = fieldWidth * fieldHeight;
@@ -1712,6 +1734,7 @@ private:
 	std::unordered_map<size_t, TileMap::TileType> fieldMap;
 	//DebugControls& dc;
 	std::queue<Robo::Action> instructionQueue;
+	int nReplans = 0;
 };
 
 class RoboAIDebug_rvdw2
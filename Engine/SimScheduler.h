@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// cooperative round robin scheduler for resumable tasks
+// a task is a step function that does a bounded slice of work and returns true
+// while it wants to run again; it goes to the back of the queue after every slice,
+// so any number of simulations share a handful of threads without starving each
+// other and without an os thread (and its stack) each
+class SimScheduler
+{
+public:
+	typedef std::function<bool()> Step;
+	typedef std::function<void()> Callback;
+public:
+	explicit SimScheduler( int nWorkers )
+	{
+		nWorkers = std::max( nWorkers,1 );
+		workers.reserve( nWorkers );
+		for( int i = 0; i < nWorkers; i++ )
+		{
+			workers.emplace_back( &SimScheduler::Work,this );
+		}
+	}
+	SimScheduler( const SimScheduler& ) = delete;
+	SimScheduler& operator=( const SimScheduler& ) = delete;
+	// tasks still queued are dropped, their owners must be gone by now
+	~SimScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			dying = true;
+		}
+		cv_work.notify_all();
+		for( auto& w : workers )
+		{
+			w.join();
+		}
+	}
+	// onDone runs on a worker after the last slice, the task is never touched again after that
+	void Submit( Step step,Callback onDone = {} )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			ready.push_back( { std::move( step ),std::move( onDone ) } );
+			nUnfinished++;
+		}
+		cv_work.notify_one();
+	}
+	// blocks until every submitted task has finished
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		cv_done.wait( lock,[this]() { return nUnfinished == 0; } );
+	}
+	int GetWorkerCount() const
+	{
+		return (int)workers.size();
+	}
+	// process wide instance, one worker per hardware thread
+	static SimScheduler& GetShared()
+	{
+		static SimScheduler scheduler( (int)std::thread::hardware_concurrency() );
+		return scheduler;
+	}
+private:
+	struct Task
+	{
+		Step step;
+		Callback onDone;
+	};
+private:
+	void Work()
+	{
+		while( true )
+		{
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				cv_work.wait( lock,[this]() { return !ready.empty() || dying; } );
+				if( dying )
+				{
+					return;
+				}
+				task = std::move( ready.front() );
+				ready.pop_front();
+			}
+			if( task.step() )
+			{
+				{
+					std::lock_guard<std::mutex> lock( mutex );
+					ready.push_back( std::move( task ) );
+				}
+				cv_work.notify_one();
+				continue;
+			}
+			if( task.onDone )
+			{
+				task.onDone();
+			}
+			bool done;
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				done = --nUnfinished == 0;
+			}
+			if( done )
+			{
+				cv_done.notify_all();
+			}
+		}
+	}
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable cv_work;
+	std::condition_variable cv_done;
+	std::deque<Task> ready;
+	int nUnfinished = 0;
+	bool dying = false;
+};
\ No newline at end of file
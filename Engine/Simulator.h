@@ -1,21 +1,35 @@
 #pragma once
 
-#include "Sound.h"
 #include "TileMap.h"
+#include "MapAnalysis.h"
+#include "MapArchive.h"
 #include "Robo.h"
-#include "RoboAI\RoboAI.h"
+#include "RoboAI/RoboAI.h"
+#include "RoboAI/AiRegistry.h"
 #include "DebugControls.h"
 #include <future>
-#include "Font.h"
+#ifndef ROBOMAZE_HEADLESS
+#include "Sound.h"
+#include "Assets.h"
 #include "MainWindow.h"
 #include "Window.h"
-#include "Config.h"
 #include "Gameable.h"
+#endif
+#include "Config.h"
+#include "TscClock.h"
+#include "Histogram.h"
+#include "SimScheduler.h"
 #include <atomic>
+#include <thread>
+#include <limits>
+#include <memory>
 #include <deque>
 #include <unordered_set>
 
-class Simulator : public Gameable
+class Simulator
+#ifndef ROBOMAZE_HEADLESS
+	: public Gameable
+#endif
 {
 public:
 	enum class State
@@ -27,22 +41,38 @@ public:
 	};
 public:
 	Simulator( const Config& config,size_t seed )
+		:
+		Simulator( config,seed,LoadMap( config,seed ) )
+	{}
+	// map must be LoadMap( config,seed ), made ahead of time (e.g. by the evaluator's generators)
+	Simulator( const Config& config,size_t seed,TileMap map_in )
 		:
 		seed( (unsigned int)seed ),
-		map( LoadMap( config,seed ) ),
+		map( std::move( map_in ) ),
 		rob( map.GetStartPos(),map.GetStartDirection() ),
-		goalReachable( ComputeGoalReachability() ),
+		// file maps are analysed once per map, procedural ones are new every run and
+		// only need the (early out) reachability search, and so do archive maps
+		// (a sweep reads each of them once and they have no file of their own to
+		// keep a sidecar next to)
+		analysis( config.GetMapMode() == Config::MapMode::File &&
+			!MapArchive::IsArchiveFile( config.GetMapFilename() ) ?
+			MapAnalysis::Get( map,config.GetMapFilename() ) : nullptr ),
+		goalReachable( analysis ? analysis->GetGoalDistance( rob.GetPos() ) >= 0 : ComputeGoalReachability() ),
 		max_moves( config.GetMaxMoves() )
 	{
+#ifndef ROBOMAZE_HEADLESS
 		stateTexts.resize( (int)State::Count );
 		stateTexts[(int)State::Success] = { { "Done" },Colors::White };
 		stateTexts[(int)State::Failure] = { { "Fail" },Colors::Red };
 		stateTexts[(int)State::Working] = { { "Work" },Colors::Green };
+#endif
 	}
+	virtual ~Simulator() = default;
 	int GetMoveCount() const
 	{
 		return move_count;
 	}
+#ifndef ROBOMAZE_HEADLESS
 	void Draw( Graphics& gfx ) const override
 	{
 		// move count bottom right
@@ -62,6 +92,7 @@ public:
 	}
 	void Update( MainWindow& wnd,float dt ) override
 	{}
+#endif
 	bool GoalReached() const
 	{
 		return map.At( rob.GetPos() ) == TileMap::TileType::Goal;
@@ -100,6 +131,50 @@ public:
 	{
 		return 0.0f;
 	}
+	virtual int GetReplanCount() const
+	{
+		return 0;
+	}
+	// whole map analysis, file maps only (null for procedural maps)
+	const MapAnalysis* GetAnalysis() const
+	{
+		return analysis.get();
+	}
+	// the map a simulation of this config and seed plays on
+	static TileMap LoadMap( const Config& config,size_t seed )
+	{
+		if( config.GetMapMode() == Config::MapMode::Procedural )
+		{
+			std::mt19937 rng( (unsigned int)seed );
+			return TileMap( config,rng );
+		}
+		else
+		{
+			// generate direction if random
+			std::mt19937 rng( (unsigned int)seed );
+			std::uniform_int_distribution<int> dist( 0,3 );
+			const Direction dir( (Direction::Type)dist( rng ) );
+			// one map out of a corpus archive, mapped once per process
+			if( MapArchive::IsArchiveFile( config.GetMapFilename() ) )
+			{
+				return MapArchive::Open( config.GetMapFilename() )->Get( config.GetMapIndex(),dir );
+			}
+			// load tilemap with direction
+			return TileMap( config.GetMapFilename(),dir );
+		}
+	}
+	// rough peak bytes for one simulation of this config (map + generator
+	// scratch + reachability set + ai field cache), used to throttle batches
+	static size_t EstimateMemoryFootprint( const Config& config )
+	{
+		constexpr size_t bytesPerCell = 64u;
+		constexpr size_t fixedOverhead = 1u << 20;
+		const size_t nCells = config.GetMapMode() == Config::MapMode::Procedural ?
+			(size_t)config.GetMapWidth() * (size_t)config.GetMapHeight() :
+			// file map size is unknown until loaded, assume a typical 1000x1000
+			1000u * 1000u;
+		return nCells * bytesPerCell + fixedOverhead;
+	}
 
 public:
 //RVDW protected:
@@ -109,130 +184,191 @@ public:
 	}
 	TileMap map;
 	Robo rob;
-	Font font = Font( "Images\\Fixedsys16x28.bmp" );
+#ifndef ROBOMAZE_HEADLESS
+	// shared through the asset cache instead of loaded per instance
+	const Font& font = Assets::GetFont( "Images/Fixedsys16x28.bmp" );
+#endif
 private:
 	bool ComputeGoalReachability() const
 	{
-		// create queue for 'frontier'
-		std::deque<Vei2> frontier;
-
-		// hash function for positions
-		struct Vei2Hash
+		// tile codes unpacked straight from the packed rows into a grid whose
+		// sentinel border reads as wall; visited cells are walled up too, so a
+		// neighbor is a plain index offset with no bounds or visited check
+		typedef PackedGrid<TileMap::TileType> Packed;
+		const char wall = (char)TileMap::TileType::Wall;
+		const char floor = (char)TileMap::TileType::Floor;
+		const char goal = (char)TileMap::TileType::Goal;
+		const auto& tiles = map.GetTiles();
+		const auto wordsPerRow = Packed::GetWordsPerRow( tiles.GetWidth() );
+		Grid<char> cells( tiles.GetWidth(),tiles.GetHeight(),wall,wall );
+		for( int y = 0; y < tiles.GetHeight(); y++ )
 		{
-			size_t operator()( const Vei2& pos ) const
+			const uint64_t* pRow = tiles.Data() + (size_t)y * wordsPerRow;
+			char* pCells = &cells.At( 0,y );
+			for( int x = 0; x < tiles.GetWidth(); x++ )
 			{
-				const std::hash<int> hasher;
-				const size_t seed = hasher( pos.x );
-				return seed ^ (hasher( pos.y ) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+				pCells[x] = char( (pRow[x / Packed::cellsPerWord] >> (x % Packed::cellsPerWord * Packed::bitsPerCell)) & 3u );
 			}
-		};
-
-		// set of closed nodes (reserve a decent amount of space)
-		std::unordered_set<Vei2,Vei2Hash> closed;
-		closed.reserve( map.GetGridHeight() * map.GetGridWidth() );
-
-		// add current tile to frontier to0 start the ball rollin
-		frontier.push_back( rob.GetPos() );
-		closed.insert( rob.GetPos() );
-
-		while( !frontier.empty() )
+		}
+		std::vector<size_t> frontier( 1,cells.GetIndex( rob.GetPos() ) );
+		cells[frontier.front()] = wall;
+		bool found = false;
+		while( !frontier.empty() && !found )
 		{
-			const auto base = frontier.front();
-			frontier.pop_front();
-
-			auto dir = Direction::Up();
-			for( int i = 0; i < 4; i++,dir.RotateClockwise() )
+			const auto i = frontier.back();
+			frontier.pop_back();
+			cells.VisitNeighborIndices( i,[&]( size_t n )
 			{
-				const auto nodePos = base + dir;
-				const auto node = map.At( nodePos );
-				if( node == TileMap::TileType::Goal )
+				if( cells[n] == goal )
 				{
-					// goal is reachable
-					return true;
+					found = true;
 				}
-				else if( node == TileMap::TileType::Floor && closed.find( nodePos ) == closed.cend() )
+				else if( cells[n] == floor )
 				{
-					frontier.push_back( nodePos );
-					closed.insert( nodePos );
+					cells[n] = wall;
+					frontier.push_back( n );
 				}
-			}
-		}
-		// cannot reach goal
-		return false;
-	}
-	static TileMap LoadMap( const Config& config,size_t seed )
-	{
-		if( config.GetMapMode() == Config::MapMode::Procedural )
-		{
-			std::mt19937 rng( (unsigned int)seed );
-			return TileMap( config,rng );
-		}
-		else
-		{
-			// generate direction if random
-			std::mt19937 rng( (unsigned int)seed );
-			std::uniform_int_distribution<int> dist( 0,3 );
-			// load tilemap with direction
-			return TileMap( config.GetMapFilename(),(Direction::Type)dist( rng ) );
+			} );
 		}
+		return found;
 	}
 private:
 	unsigned int seed;
+	std::shared_ptr<const MapAnalysis> analysis;
 	bool goalReachable;
 	int move_count = 0;
 	int max_moves;
 	State state = State::Working;
+#ifndef ROBOMAZE_HEADLESS
 	std::vector<std::pair<std::string,Color>> stateTexts;
+#endif
 };
 
-class HeadlessSimulator : public Simulator
+// steps the ai on whichever thread calls Run() / Step()
+// the ai is picked by name from the registry once, in the constructor
+class BatchSimulator : public Simulator
 {
 public:
-	HeadlessSimulator( const Config& config,size_t seed = 0u )
+	BatchSimulator( const Config& config,size_t seed )
 		:
-		Simulator( config,seed )
+		Simulator( config,seed ),
+		makeAi( AiRegistry<BatchSimulator>::Find( config.GetAiName() ) )
+	{}
+	BatchSimulator( const Config& config,size_t seed,TileMap map )
+		:
+		Simulator( config,seed,std::move( map ) ),
+		makeAi( AiRegistry<BatchSimulator>::Find( config.GetAiName() ) )
+	{}
+	// to completion
+	void Run()
+	{
+		while( Step( std::numeric_limits<int>::max() ) );
+	}
+	// runs at most maxMoves moves, returns true while the simulation needs more
+	// (lets a SimScheduler interleave many simulations on a few threads)
+	bool Step( int maxMoves )
+	{
+		if( Finished() || dying )
+		{
+			return false;
+		}
+		// ai state only exists while the simulation is being stepped
+		if( !pAi )
+		{
+			pAi = makeAi();
+		}
+		const bool more = pAi->Step( *this,maxMoves );
+		nReplans = pAi->GetReplanCount();
+		if( !more )
+		{
+			pAi.reset();
+		}
+		return more;
+	}
+	// step loop compiled per ai type, no indirection per move
+	template<typename AI>
+	bool StepWith( AI& ai,int maxMoves )
 	{
-		worker = std::thread( [this]()
+		for( int n = 0; n < maxMoves && !Finished() && !dying; n++ )
 		{
-			RoboAI ai;
-			FrameTimer ft;
+			const auto view = rob.GetView( map );
+			const auto start = TscClock::Now();
+			const auto action = ai.Plan( view );
+			const auto ticks = TscClock::Now() - start;
+			planLatency.Record( ticks );
+			planTicks += ticks;
+			workingTime = (float)TscClock::ToSeconds( planTicks );
+			rob.TakeAction( action,map );
+			UpdateState( action );
+			IncrementMoveCount();
+		}
+		return !Finished() && !dying;
+	}
+	// makes Run() / Step() return early (safe to call from another thread)
+	void Stop()
+	{
+		dying = true;
+	}
+	float GetWorkingTime() const override
+	{
+		return workingTime;
+	}
+	int GetReplanCount() const override
+	{
+		return nReplans;
+	}
+	// per Plan() call latency in TscClock ticks
+	const Histogram& GetPlanLatency() const
+	{
+		return planLatency;
+	}
+private:
+	AiRegistry<BatchSimulator>::MakeFunc makeAi;
+	std::unique_ptr<AiStepper<BatchSimulator>> pAi;
+	uint64_t planTicks = 0u;
+	float workingTime = 0.0f;
+	int nReplans = 0;
+	Histogram planLatency;
+	std::atomic<bool> dying = false;
+};
 
-			while( !Finished() && !dying )
-			{
-				const auto view = rob.GetView( map );
-				ft.Mark();
-				const auto action = ai.Plan( view );
-				workingTime += ft.Mark();
-				rob.TakeAction( action,map );
-				UpdateState( action );
-				IncrementMoveCount();
-			}
-		} );
+// runs in the background on the shared scheduler, a slice of moves at a time
+class HeadlessSimulator : public BatchSimulator
+{
+public:
+	HeadlessSimulator( const Config& config,size_t seed = 0u )
+		:
+		BatchSimulator( config,seed ),
+		done( donePromise.get_future() )
+	{
+		SimScheduler::GetShared().Submit(
+			[this]() { return Step( sliceMoves ); },
+			[this]() { donePromise.set_value(); }
+		);
 	}
+#ifndef ROBOMAZE_HEADLESS
 	void Draw( Graphics& gfx ) const override
 	{
 		Simulator::Draw( gfx );
 		font.DrawText(
-			std::to_string( workingTime ),
+			std::to_string( GetWorkingTime() ),
 			{ Graphics::GetScreenRect().left + 5,Graphics::GetScreenRect().bottom - 30 },
 			Colors::White,gfx
 		);
 	}
+#endif
 	~HeadlessSimulator() override
 	{
-		dying = true;
-		worker.join();
-	}
-	float GetWorkingTime() const override
-	{
-		return workingTime;
+		Stop();
+		done.wait();
 	}
 private:
-	float workingTime = 0.0f;
-	std::thread worker;
-	std::atomic<bool> dying = false;
+	static constexpr int sliceMoves = 4096;
+	std::promise<void> donePromise;
+	std::future<void> done;
 };
 
+#ifndef ROBOMAZE_HEADLESS
 class VisualSimulator : public Simulator,public Window::SimstepControllable
 {
 public:
@@ -378,4 +514,5 @@ public:
 	}
 private:
 	RoboAI ai;
-};
\ No newline at end of file
+};
+#endif
\ No newline at end of file
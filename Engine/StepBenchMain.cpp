@@ -0,0 +1,176 @@
+// microbenchmark for the robot step kernel (GetView + TakeAction)
+// usage: robomaze_stepbench [ini file] [steps]  (run from the Engine directory)
+// runs each benchmark twice: once with a frozen copy of the original kernel
+// (Direction math, one At() per cell) and once with Robo as it is now, checks
+// both agree and prints the rates, so a change to Robo's step can be measured
+// against the reference before it lands
+// walk: a fixed pseudo random policy on the evaluator stress map (steps / s,
+// includes the policy's own branches)
+// views: GetView on robots spread over random floor cells / headings (views / s)
+#include "Config.h"
+#include "Evaluator.h"
+#include "Robo.h"
+#include <iostream>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+#include <vector>
+#include <random>
+
+// the step kernel as it was originally, the reference Robo is measured against
+class ReferenceRobo
+{
+public:
+	ReferenceRobo( const Vei2& pos,const Direction& dir )
+		:
+		pos( pos ),
+		dir( dir )
+	{}
+	std::array<TileMap::TileType,3> GetView( const TileMap& map ) const
+	{
+		auto scan_pos = pos + dir + dir.GetRotatedCounterClockwise();
+		const auto scan_delta = dir.GetRotatedClockwise();
+		std::array<TileMap::TileType,3> view;
+		for( int i = 0; i < 3; i++,scan_pos += scan_delta )
+		{
+			view[i] = map.At( scan_pos );
+		}
+		return view;
+	}
+	void TakeAction( Robo::Action action,const TileMap& map )
+	{
+		switch( action )
+		{
+		case Robo::Action::MoveForward:
+			if( map.At( pos + dir ) != TileMap::TileType::Wall )
+			{
+				pos = pos + dir;
+			}
+			break;
+		case Robo::Action::TurnRight:
+			dir.RotateClockwise();
+			break;
+		case Robo::Action::TurnLeft:
+			dir.RotateCounterClockwise();
+			break;
+		default:
+			break;
+		}
+	}
+	Vei2 GetPos() const
+	{
+		return pos;
+	}
+private:
+	Vei2 pos;
+	Direction dir;
+};
+
+struct WalkResult
+{
+	uint64_t checksum;
+	double seconds;
+};
+
+// forward while the way is open, otherwise turn; a cheap lcg breaks up loops
+template<typename R>
+WalkResult Walk( R rob,const TileMap& map,int nSteps )
+{
+	uint32_t lcg = 12345u;
+	uint64_t checksum = 0u;
+	const auto start = std::chrono::steady_clock::now();
+	for( int i = 0; i < nSteps; i++ )
+	{
+		const auto view = rob.GetView( map );
+		lcg = lcg * 1664525u + 1013904223u;
+		Robo::Action action;
+		if( view[1] != TileMap::TileType::Wall && (lcg >> 28) != 0u )
+		{
+			action = Robo::Action::MoveForward;
+		}
+		else
+		{
+			action = (lcg >> 27) & 1u ? Robo::Action::TurnLeft : Robo::Action::TurnRight;
+		}
+		rob.TakeAction( action,map );
+		checksum = checksum * 31u + (uint64_t)view[0] * 9u + (uint64_t)view[1] * 3u + (uint64_t)view[2];
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const auto pos = rob.GetPos();
+	checksum ^= ((uint64_t)pos.x << 32) | (uint32_t)pos.y;
+	return { checksum,elapsed.count() };
+}
+
+// independent view lookups, so the rate is bounded by the kernel rather than by
+// one step waiting on the last
+template<typename R>
+WalkResult Look( const std::vector<R>& robs,const TileMap& map,int nViews )
+{
+	uint64_t checksum = 0u;
+	const auto start = std::chrono::steady_clock::now();
+	for( int i = 0; i < nViews; )
+	{
+		for( auto r = robs.cbegin(); r != robs.cend() && i < nViews; ++r,i++ )
+		{
+			const auto view = r->GetView( map );
+			checksum += (uint64_t)view[0] * 9u + (uint64_t)view[1] * 3u + (uint64_t)view[2];
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return { checksum,elapsed.count() };
+}
+
+int main( int argc,char* argv[] )
+{
+	try
+	{
+		const Config config( argc > 1 ? argv[1] : "sim.ini" );
+		const int nSteps = argc > 2 ? std::stoi( argv[2] ) : 50000000;
+		std::mt19937 rng( config.GetSeed() );
+		const TileMap map( Evaluator::MakeStressConfig( config ),rng );
+		std::cout << "map " << map.GetGridWidth() << "x" << map.GetGridHeight()
+			<< ", " << nSteps << " steps" << std::endl;
+
+		const auto ref = Walk( ReferenceRobo( map.GetStartPos(),map.GetStartDirection() ),map,nSteps );
+		const auto cur = Walk( Robo( map.GetStartPos(),map.GetStartDirection() ),map,nSteps );
+		std::cout << "walk  reference: " << nSteps / ref.seconds / 1e6 << " Msteps/s" << std::endl;
+		std::cout << "walk  robo:      " << nSteps / cur.seconds / 1e6 << " Msteps/s" << std::endl;
+		if( ref.checksum != cur.checksum )
+		{
+			std::cerr << "robomaze_stepbench: walks diverged" << std::endl;
+			return 1;
+		}
+
+		// robots on random floor cells (every floor cell has a wall border around the map)
+		std::vector<ReferenceRobo> refRobs;
+		std::vector<Robo> robs;
+		std::uniform_int_distribution<int> xDist( 1,map.GetGridWidth() - 2 );
+		std::uniform_int_distribution<int> yDist( 1,map.GetGridHeight() - 2 );
+		std::uniform_int_distribution<int> dirDist( 0,3 );
+		while( robs.size() < 1u << 16 )
+		{
+			const Vei2 pos = { xDist( rng ),yDist( rng ) };
+			const Direction dir( (Direction::Type)dirDist( rng ) );
+			if( map.At( pos ) != TileMap::TileType::Wall )
+			{
+				refRobs.emplace_back( pos,dir );
+				robs.emplace_back( pos,dir );
+			}
+		}
+		const auto refLook = Look( refRobs,map,nSteps );
+		const auto curLook = Look( robs,map,nSteps );
+		std::cout << "views reference: " << nSteps / refLook.seconds / 1e6 << " Mviews/s" << std::endl;
+		std::cout << "views robo:      " << nSteps / curLook.seconds / 1e6 << " Mviews/s" << std::endl;
+		if( refLook.checksum != curLook.checksum )
+		{
+			std::cerr << "robomaze_stepbench: views diverged" << std::endl;
+			return 1;
+		}
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "robomaze_stepbench: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+// fixed size pool of workers, each with its own job deque
+// workers pop from the back of their own deque and steal from the
+// front of the others' when they run dry
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Job;
+public:
+	explicit ThreadPool( int nWorkers )
+	{
+		nWorkers = std::max( nWorkers,1 );
+		queues.reserve( nWorkers );
+		for( int i = 0; i < nWorkers; i++ )
+		{
+			queues.push_back( std::make_unique<Queue>() );
+		}
+		workers.reserve( nWorkers );
+		for( int i = 0; i < nWorkers; i++ )
+		{
+			workers.emplace_back( &ThreadPool::Work,this,i );
+		}
+	}
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			dying = true;
+		}
+		cv_work.notify_all();
+		for( auto& w : workers )
+		{
+			w.join();
+		}
+	}
+	void Submit( Job job )
+	{
+		// deal jobs out round robin, stealing evens out the rest
+		auto& q = *queues[next++ % queues.size()];
+		{
+			std::lock_guard<std::mutex> lock( q.mutex );
+			q.jobs.push_back( std::move( job ) );
+		}
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			nQueued++;
+			nUnfinished++;
+		}
+		cv_work.notify_one();
+	}
+	// blocks until every submitted job has finished running
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		cv_done.wait( lock,[this]() { return nUnfinished == 0; } );
+	}
+	int GetWorkerCount() const
+	{
+		return (int)workers.size();
+	}
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+private:
+	void Work( int i )
+	{
+		while( true )
+		{
+			// reserve one of the queued jobs (guarantees there is one to find)
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				cv_work.wait( lock,[this]() { return nQueued > 0 || dying; } );
+				if( nQueued == 0 )
+				{
+					return;
+				}
+				nQueued--;
+			}
+			Job job;
+			while( !TryPop( i,job ) )
+			{
+				std::this_thread::yield();
+			}
+			job();
+			bool done;
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				done = --nUnfinished == 0;
+			}
+			if( done )
+			{
+				cv_done.notify_all();
+			}
+		}
+	}
+	bool TryPop( int i,Job& job )
+	{
+		// own deque first (lifo)
+		{
+			auto& q = *queues[i];
+			std::lock_guard<std::mutex> lock( q.mutex );
+			if( !q.jobs.empty() )
+			{
+				job = std::move( q.jobs.back() );
+				q.jobs.pop_back();
+				return true;
+			}
+		}
+		// steal from the others (fifo)
+		for( size_t n = 1; n < queues.size(); n++ )
+		{
+			auto& q = *queues[(i + n) % queues.size()];
+			std::lock_guard<std::mutex> lock( q.mutex );
+			if( !q.jobs.empty() )
+			{
+				job = std::move( q.jobs.front() );
+				q.jobs.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+private:
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> next = 0u;
+	std::mutex mutex;
+	std::condition_variable cv_work;
+	std::condition_variable cv_done;
+	int nQueued = 0;
+	int nUnfinished = 0;
+	bool dying = false;
+};
@@ -1,104 +1,645 @@
 #include "TileMap.h"
 #include "Config.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 #include <random>
+#include <cstring>
+#include <climits>
+#include <numeric>
+
+namespace
+{
+	// .rmz layout: this header, then the tile rows exactly as PackedGrid keeps
+	// them (little endian 64 bit words, 2 bit TileType codes), so loading is a
+	// mapping and a few checks; bump version whenever the layout changes
+	struct RmzHeader
+	{
+		char magic[4];
+		uint32_t version;
+		int32_t width;
+		int32_t height;
+		int32_t startX;
+		int32_t startY;
+		// Direction::Type, or -1 to let the loader pick
+		int32_t startDir;
+		uint32_t reserved;
+	};
+	static_assert( sizeof( RmzHeader ) == 32,"rmz header must keep the tiles 8 byte aligned" );
+	const char rmzMagic[4] = { 'R','M','Z','\x1a' };
+	const uint32_t rmzVersion = 1u;
+
+	// tile code for every byte value, 0xFF for anything that is not a tile
+	struct TileLut
+	{
+		TileLut()
+		{
+			std::fill( std::begin( codes ),std::end( codes ),(uint8_t)0xFFu );
+			codes[(unsigned char)'#'] = (uint8_t)TileMap::TileType::Wall;
+			codes[(unsigned char)'.'] = (uint8_t)TileMap::TileType::Floor;
+			codes[(unsigned char)'%'] = (uint8_t)TileMap::TileType::Goal;
+		}
+		uint8_t codes[256];
+	};
+
+	bool IsBlank( char c )
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	// 1 based line / column of pAt, only worked out when there is an error to report
+	std::string Where( const char* pBegin,const char* pAt )
+	{
+		const auto line = std::count( pBegin,pAt,'\n' ) + 1;
+		const char* pLine = pAt;
+		while( pLine != pBegin && pLine[-1] != '\n' )
+		{
+			pLine--;
+		}
+		return "line " + std::to_string( line ) + ", column " + std::to_string( pAt - pLine + 1 );
+	}
+
+	// skips leading blanks, false (p pointing at the offender) if no number follows
+	bool ReadInt( const char*& p,const char* pEnd,int& val )
+	{
+		while( p != pEnd && IsBlank( *p ) )
+		{
+			p++;
+		}
+		const bool negative = p != pEnd && *p == '-';
+		const char* const pDigits = negative ? p + 1 : p;
+		const char* q = pDigits;
+		long long acc = 0;
+		for( ; q != pEnd && *q >= '0' && *q <= '9' && acc <= INT_MAX; q++ )
+		{
+			acc = acc * 10 + (*q - '0');
+		}
+		if( q == pDigits || acc > INT_MAX || (q != pEnd && !IsBlank( *q )) )
+		{
+			return false;
+		}
+		val = int( negative ? -acc : acc );
+		p = q;
+		return true;
+	}
+
+	// classifies one row into packed words (PackedGrid layout)
+	// branch free inner loop, bad bytes are only looked for once the row is done
+	// returns the index of the first bad byte, or -1
+	int PackRow( const TileLut& lut,const char* pRow,int width,uint64_t* pWords )
+	{
+		constexpr int cellsPerWord = PackedGrid<TileMap::TileType>::cellsPerWord;
+		uint8_t bad = 0u;
+		for( int x0 = 0; x0 < width; x0 += cellsPerWord )
+		{
+			const int n = std::min( width - x0,cellsPerWord );
+			uint64_t word = 0u;
+			for( int i = 0; i < n; i++ )
+			{
+				const uint8_t code = lut.codes[(unsigned char)pRow[x0 + i]];
+				bad |= code;
+				word |= uint64_t( code & 3u ) << (i * 2);
+			}
+			pWords[x0 / cellsPerWord] = word;
+		}
+		if( (bad & 0x80u) == 0u )
+		{
+			return -1;
+		}
+		int x = 0;
+		while( lut.codes[(unsigned char)pRow[x]] != 0xFFu )
+		{
+			x++;
+		}
+		return x;
+	}
+
+	// run length encoded row (<count><tile>, e.g. 40#.%) expanded into out
+	// returns the first byte that is not part of a valid run, or nullptr
+	const char* ExpandRle( const TileLut& lut,const char* pRow,const char* pRowEnd,int width,std::string& out )
+	{
+		out.clear();
+		for( const char* p = pRow; p != pRowEnd; p++ )
+		{
+			int count = 1;
+			if( *p >= '0' && *p <= '9' )
+			{
+				count = 0;
+				for( ; p != pRowEnd && *p >= '0' && *p <= '9'; p++ )
+				{
+					count = count * 10 + (*p - '0');
+					if( count > width )
+					{
+						return p;
+					}
+				}
+				if( p == pRowEnd || count == 0 )
+				{
+					return p;
+				}
+			}
+			if( lut.codes[(unsigned char)*p] == 0xFFu )
+			{
+				return p;
+			}
+			out.append( (size_t)count,*p );
+		}
+		return nullptr;
+	}
+
+	// floors of the rooms placed so far, bucketed by bucketSize x bucketSize area
+	// rooms are smaller than a bucket, so whether a new room's rect is free only
+	// takes the few rooms in the (at most 4) buckets it touches, not a read of
+	// every cell under it; answers exactly what that read would
+	class RoomIndex
+	{
+	public:
+		static constexpr int bucketShift = 5;
+		static constexpr int bucketSize = 1 << bucketShift;
+	public:
+		RoomIndex( int width,int height )
+			:
+			bucketsPerRow( (width >> bucketShift) + 1 ),
+			buckets( (size_t)bucketsPerRow * ((height >> bucketShift) + 1) )
+		{}
+		// rect is half open, like RectI
+		void Add( const RectI& rect )
+		{
+			for( int by = rect.top >> bucketShift; by <= (rect.bottom - 1) >> bucketShift; by++ )
+			{
+				for( int bx = rect.left >> bucketShift; bx <= (rect.right - 1) >> bucketShift; bx++ )
+				{
+					buckets[(size_t)by * bucketsPerRow + bx].push_back( rect );
+				}
+			}
+		}
+		bool IsFree( const RectI& rect ) const
+		{
+			for( int by = rect.top >> bucketShift; by <= (rect.bottom - 1) >> bucketShift; by++ )
+			{
+				for( int bx = rect.left >> bucketShift; bx <= (rect.right - 1) >> bucketShift; bx++ )
+				{
+					for( const auto& room : buckets[(size_t)by * bucketsPerRow + bx] )
+					{
+						if( room.IsOverlappingWith( rect ) )
+						{
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		}
+	private:
+		int bucketsPerRow;
+		std::vector<std::vector<RectI>> buckets;
+	};
+
+	// union find over ids 0..count-1, sets are named by their root
+	class DisjointSet
+	{
+	public:
+		explicit DisjointSet( int count )
+			:
+			parents( (size_t)count )
+		{
+			std::iota( parents.begin(),parents.end(),0 );
+		}
+		int Find( int id )
+		{
+			while( parents[id] != id )
+			{
+				// path halving
+				parents[id] = parents[parents[id]];
+				id = parents[id];
+			}
+			return id;
+		}
+		// both have to be roots, other's set joins root's
+		void Link( int root,int other )
+		{
+			parents[other] = root;
+		}
+	private:
+		std::vector<int> parents;
+	};
+
+	// fallback for the kruskal linkers when the door cells ran out before all
+	// sets were joined: every floor component floods the non floor cells (never
+	// the outer ring) at once, and where two floods of unjoined components meet,
+	// both paths back to the floor are dug out; one pass over the grid
+	void ConnectFloor( Grid<TileMap::TileType>& tiles )
+	{
+		using TileType = TileMap::TileType;
+		constexpr size_t none = ~size_t( 0 );
+		const auto IsInside = [&tiles]( size_t i )
+		{
+			const auto pos = tiles.GetPos( i );
+			return pos.x > 0 && pos.y > 0 && pos.x < tiles.GetWidth() - 1 && pos.y < tiles.GetHeight() - 1;
+		};
+		std::vector<int> owners( tiles.size(),-1 );
+		std::vector<size_t> parents( tiles.size(),none );
+		std::vector<size_t> queue;
+		// label the components, their cells seed the flood
+		int nComponents = 0;
+		for( int y = 1; y < tiles.GetHeight() - 1; y++ )
+		{
+			for( int x = 1; x < tiles.GetWidth() - 1; x++ )
+			{
+				const size_t seed = tiles.GetIndex( x,y );
+				if( tiles[seed] != TileType::Floor || owners[seed] != -1 )
+				{
+					continue;
+				}
+				owners[seed] = nComponents;
+				queue.push_back( seed );
+				for( size_t q = queue.size() - 1; q < queue.size(); q++ )
+				{
+					tiles.VisitNeighborIndices( queue[q],[&]( size_t n )
+					{
+						if( owners[n] == -1 && tiles[n] == TileType::Floor )
+						{
+							owners[n] = nComponents;
+							queue.push_back( n );
+						}
+					} );
+				}
+				nComponents++;
+			}
+		}
+		DisjointSet sets( std::max( nComponents,1 ) );
+		int nSets = nComponents;
+		for( size_t q = 0; q < queue.size() && nSets > 1; q++ )
+		{
+			const size_t cur = queue[q];
+			tiles.VisitNeighborIndices( cur,[&]( size_t n )
+			{
+				if( !IsInside( n ) )
+				{
+					return;
+				}
+				if( owners[n] == -1 )
+				{
+					owners[n] = owners[cur];
+					parents[n] = cur;
+					queue.push_back( n );
+					return;
+				}
+				const int a = sets.Find( owners[cur] );
+				const int b = sets.Find( owners[n] );
+				if( a != b )
+				{
+					for( size_t i : { cur,n } )
+					{
+						for( ; tiles[i] != TileType::Floor; i = parents[i] )
+						{
+							tiles[i] = TileType::Floor;
+						}
+					}
+					sets.Link( a,b );
+					nSets--;
+				}
+			} );
+		}
+	}
+
+	// generator 4 region side length (wall line to wall line, roughly)
+	constexpr int regionSize = 256;
+}
 
 TileMap::TileMap( const std::string& filename,const Direction& sd )
 	:
-	pFloorSurf( std::make_unique<Surface>( "Images\\floor.bmp" ) ),
-	pWallSurf( std::make_unique<Surface>( "Images\\wall.bmp" ) ),
-	pGoalSurf( std::make_unique<Surface>( "Images\\goal.bmp" ) ),
-	tileWidth( pFloorSurf->GetWidth() ),
-	tileHeight( pFloorSurf->GetHeight() ),
 	start_dir( sd )
 {
-	const auto ThrowIfFalse = []( bool pred,const std::string& msg )
+	if( IsBinaryMapFile( filename ) )
+	{
+		LoadBinary( filename );
+	}
+	else
+	{
+		LoadText( filename );
+	}
+}
+
+bool TileMap::IsBinaryMapFile( const std::string& filename )
+{
+	const std::string ext = ".rmz";
+	return filename.size() >= ext.size() &&
+		filename.compare( filename.size() - ext.size(),ext.size(),ext ) == 0;
+}
+
+void TileMap::LoadBinary( const std::string& filename )
+{
+	const auto ThrowIfFalse = [&filename]( bool pred,const std::string& msg )
 	{
 		if( !pred )
 		{
-			throw std::runtime_error( "Tilemap load error.\n" + msg );
+			throw std::runtime_error( "Tilemap load error.\nFile: '" + filename + "' " + msg );
+		}
+	};
+
+	auto file = std::make_shared<const MappedFile>( filename );
+	ThrowIfFalse( file->GetSize() >= sizeof( RmzHeader ),"is too short for an rmz header." );
+	const auto& header = *reinterpret_cast<const RmzHeader*>( file->GetData() );
+	ThrowIfFalse( std::equal( std::begin( rmzMagic ),std::end( rmzMagic ),header.magic ),"is not an rmz map." );
+	ThrowIfFalse( header.version == rmzVersion,"has rmz version " + std::to_string( header.version ) +
+		", expected " + std::to_string( rmzVersion ) + "."
+	);
+	ThrowIfFalse( header.width > 0 && header.width <= maxSideLength &&
+		header.height > 0 && header.height <= maxSideLength,"has bad dimensions " +
+		std::to_string( header.width ) + "x" + std::to_string( header.height ) + "."
+	);
+	ThrowIfFalse( header.startX >= 0 && header.startX < header.width &&
+		header.startY >= 0 && header.startY < header.height,"has start pos outside the map."
+	);
+	ThrowIfFalse( header.startDir >= -1 && header.startDir < (int)Direction::Type::Count,
+		"has bad start direction " + std::to_string( header.startDir ) + "."
+	);
+	const size_t nWords = (size_t)PackedGrid<TileType>::GetWordsPerRow( header.width ) * (size_t)header.height;
+	ThrowIfFalse( file->GetSize() == sizeof( RmzHeader ) + nWords * sizeof( uint64_t ),"has the wrong size for its dimensions." );
+
+	start_pos = { header.startX,header.startY };
+	if( header.startDir != -1 )
+	{
+		start_dir = Direction( (Direction::Type)header.startDir );
+	}
+	// tiles point straight into the mapping, which lives as long as any copy of them
+	const auto pWords = reinterpret_cast<const uint64_t*>( &header + 1 );
+	tiles = PackedGrid<TileType>( header.width,header.height,pWords,std::move( file ) );
+}
+
+void TileMap::SaveBinary( const std::string& filename,bool storeStartDir ) const
+{
+	RmzHeader header;
+	std::copy( std::begin( rmzMagic ),std::end( rmzMagic ),header.magic );
+	header.version = rmzVersion;
+	header.width = tiles.GetWidth();
+	header.height = tiles.GetHeight();
+	header.startX = start_pos.x;
+	header.startY = start_pos.y;
+	header.startDir = storeStartDir ? (int32_t)start_dir.GetType() : -1;
+	header.reserved = 0u;
+
+	std::ofstream file( filename,std::ios::binary );
+	if( !file )
+	{
+		throw std::runtime_error( "Tilemap save error.\nFile: '" + filename + "' could not be opened." );
+	}
+	const size_t nWords = (size_t)PackedGrid<TileType>::GetWordsPerRow( tiles.GetWidth() ) * tiles.GetHeight();
+	file.write( reinterpret_cast<const char*>( &header ),sizeof( header ) );
+	file.write( reinterpret_cast<const char*>( tiles.Data() ),nWords * sizeof( uint64_t ) );
+}
+
+uint64_t TileMap::GetContentHash() const
+{
+	uint64_t hash = 14695981039346656037u;
+	const auto Mix = [&hash]( uint64_t v )
+	{
+		for( int i = 0; i < 8; i++,v >>= 8 )
+		{
+			hash = (hash ^ (v & 0xFFu)) * 1099511628211u;
+		}
+	};
+	Mix( (uint64_t)tiles.GetWidth() << 32 | (uint32_t)tiles.GetHeight() );
+	Mix( (uint64_t)start_pos.x << 32 | (uint32_t)start_pos.y );
+	// whole packed words, with the padding cells of each row's last word cleared
+	constexpr int cellsPerWord = PackedGrid<TileType>::cellsPerWord;
+	const int wordsPerRow = PackedGrid<TileType>::GetWordsPerRow( tiles.GetWidth() );
+	const int tailCells = tiles.GetWidth() % cellsPerWord;
+	const uint64_t tailMask = tailCells != 0 ?
+		(uint64_t( 1 ) << (tailCells * PackedGrid<TileType>::bitsPerCell)) - 1u : ~uint64_t( 0 );
+	const uint64_t* pRow = tiles.Data();
+	for( int y = 0; y < tiles.GetHeight(); y++,pRow += wordsPerRow )
+	{
+		for( int i = 0; i < wordsPerRow - 1; i++ )
+		{
+			Mix( pRow[i] );
 		}
+		Mix( pRow[wordsPerRow - 1] & tailMask );
+	}
+	return hash;
+}
+
+// one pass over the mapped file: numbers are read in place, rows are split with
+// memchr and classified through a byte table straight into packed words
+void TileMap::LoadText( const std::string& filename )
+{
+	// messages are only built once something is wrong, Where() is not free
+	const auto Fail = []( const std::string& msg )
+	{
+		throw std::runtime_error( "Tilemap load error.\n" + msg );
 	};
 
-	std::stringstream iss;
-	// load file into string stream buffer
-	{
-		std::ifstream file( filename );
-		ThrowIfFalse( file.good(),"File: '" + filename + "' could not be opened." );
-		iss << file.rdbuf();
-	}
-	// tile width init
-	assert( tileWidth == pWallSurf->GetWidth() );
-	assert( tileHeight == pWallSurf->GetHeight() );
-	assert( tileWidth == pGoalSurf->GetWidth() );
-	assert( tileHeight == pGoalSurf->GetHeight() );
+	const MappedFile file( filename );
+	const char* const pBegin = static_cast<const char*>( file.GetData() );
+	const char* const pEnd = pBegin + file.GetSize();
+	const char* p = pBegin;
 	// read in grid dimensions
 	int gridWidth;
 	int gridHeight;
 	{
-		iss >> gridWidth;
-		ThrowIfFalse( iss.good(),"Bad input reading grid width." );
-		ThrowIfFalse( gridWidth > 0 && gridWidth <= 1000,"Bad width: " + std::to_string( gridWidth ) );
-		iss >> gridHeight;
-		ThrowIfFalse( iss.good(),"Bad input reading grid height." );
-		ThrowIfFalse( gridHeight > 0 && gridHeight <= 1000,"Bad height: " + std::to_string( gridHeight ) );
+		if( !ReadInt( p,pEnd,gridWidth ) )
+		{
+			Fail( "Bad input reading grid width at " + Where( pBegin,p ) + "." );
+		}
+		if( gridWidth <= 0 || gridWidth > maxSideLength )
+		{
+			Fail( "Bad width: " + std::to_string( gridWidth ) );
+		}
+		if( !ReadInt( p,pEnd,gridHeight ) )
+		{
+			Fail( "Bad input reading grid height at " + Where( pBegin,p ) + "." );
+		}
+		if( gridHeight <= 0 || gridHeight > maxSideLength )
+		{
+			Fail( "Bad height: " + std::to_string( gridHeight ) );
+		}
 	}
-	// create working grid
-	Grid<Tile> tiles( gridWidth,gridHeight );
 	// read in start_pos
 	{
-		iss >> start_pos.x;
-		ThrowIfFalse( iss.good(),"Bad input reading start pos x." );
-		ThrowIfFalse( start_pos.x >= 0 && start_pos.x < gridWidth,"Bad start x: " + std::to_string( start_pos.x ) );
-		iss >> start_pos.y;
-		ThrowIfFalse( iss.good(),"Bad input reading start pos x." );
-		ThrowIfFalse( start_pos.y >= 0 && start_pos.y < gridHeight,"Bad start y: " + std::to_string( start_pos.y ) );
-	}
-	// read in tiles
-	{
-		using namespace std::string_literals;
-		tiles.reserve( gridWidth * gridHeight );
-		auto i = tiles.begin();
-		for( int y = 0; y < gridHeight; y++,i += tiles.GetWidth() )
-		{
-			std::string line;
-			iss >> line;
-			ThrowIfFalse( line.length() == gridWidth,"Bad row width in tilemap at line " + std::to_string( y ) + "." );
-			std::transform(
-				line.begin(),line.end(),
-				i,
-				[=]( char c ) -> Tile
+		if( !ReadInt( p,pEnd,start_pos.x ) )
+		{
+			Fail( "Bad input reading start pos x at " + Where( pBegin,p ) + "." );
+		}
+		if( start_pos.x < 0 || start_pos.x >= gridWidth )
+		{
+			Fail( "Bad start x: " + std::to_string( start_pos.x ) );
+		}
+		if( !ReadInt( p,pEnd,start_pos.y ) )
+		{
+			Fail( "Bad input reading start pos y at " + Where( pBegin,p ) + "." );
+		}
+		if( start_pos.y < 0 || start_pos.y >= gridHeight )
+		{
+			Fail( "Bad start y: " + std::to_string( start_pos.y ) );
+		}
+	}
+	// read in tiles, one non blank line per row (surrounding blanks and \r ignored),
+	// plain or run length encoded
+	static const TileLut lut;
+	const int wordsPerRow = PackedGrid<TileType>::GetWordsPerRow( gridWidth );
+	std::vector<uint64_t> words( (size_t)wordsPerRow * gridHeight );
+	std::string expanded;
+	int y = 0;
+	while( p != pEnd )
+	{
+		const auto pNewLine = static_cast<const char*>( std::memchr( p,'\n',size_t( pEnd - p ) ) );
+		const char* pRow = p;
+		const char* pRowEnd = pNewLine ? pNewLine : pEnd;
+		p = pNewLine ? pNewLine + 1 : pEnd;
+		while( pRow != pRowEnd && IsBlank( *pRow ) )
+		{
+			pRow++;
+		}
+		while( pRowEnd != pRow && IsBlank( pRowEnd[-1] ) )
+		{
+			pRowEnd--;
+		}
+		if( pRow == pRowEnd )
+		{
+			continue;
+		}
+		if( y == gridHeight )
+		{
+			Fail( "Unexpected row past map height " + std::to_string( gridHeight ) + " at " + Where( pBegin,pRow ) + "." );
+		}
+		uint64_t* const pWords = &words[(size_t)y * wordsPerRow];
+		const int bad = pRowEnd - pRow == gridWidth ? PackRow( lut,pRow,gridWidth,pWords ) : 0;
+		if( bad != -1 || pRowEnd - pRow != gridWidth )
+		{
+			// not a plain row, which is fine if it is a run length encoded one
+			if( std::find_if( pRow,pRowEnd,[]( char c ) { return c >= '0' && c <= '9'; } ) != pRowEnd )
 			{
-				switch( c )
+				const char* const pBad = ExpandRle( lut,pRow,pRowEnd,gridWidth,expanded );
+				if( pBad )
 				{
-				case '#':
-					return{ TileType::Wall };
-				case '.':
-					return{ TileType::Floor };
-				case '%':
-					return{ TileType::Goal };
-				default:
-					ThrowIfFalse( false,"Bad tile: '"s + c + "' in line "s + std::to_string( y ) + "."s );
-					return TileType::Wall;
+					Fail( "Bad run in encoded row at " + Where( pBegin,pBad ) + "." );
 				}
-			} );
+				if( (int)expanded.size() != gridWidth )
+				{
+					Fail( "Bad decoded row width " + std::to_string( expanded.size() ) + " (expected " +
+						std::to_string( gridWidth ) + ") at " + Where( pBegin,pRow ) + "."
+					);
+				}
+				PackRow( lut,expanded.data(),gridWidth,pWords );
+			}
+			else if( pRowEnd - pRow != gridWidth )
+			{
+				Fail( "Bad row width " + std::to_string( pRowEnd - pRow ) + " (expected " +
+					std::to_string( gridWidth ) + ") at " + Where( pBegin,pRow ) + "."
+				);
+			}
+			else
+			{
+				Fail( "Bad tile: '" + std::string( 1,pRow[bad] ) + "' at " + Where( pBegin,pRow + bad ) + "." );
+			}
 		}
-		ThrowIfFalse( iss.get() == -1 && iss.eof(),"Unexpected token at end of tilemap / wrong map height." );
+		y++;
+	}
+	if( y != gridHeight )
+	{
+		Fail( "Tilemap has " + std::to_string( y ) + " rows, expected " + std::to_string( gridHeight ) + "." );
 	}
-	// move working grid into map grid
-	this->tiles = std::move( tiles );
+	tiles = PackedGrid<TileType>( gridWidth,gridHeight,std::move( words ) );
 }
 
 TileMap::TileMap( const Config& config,std::mt19937& rng )
 	:
-	tiles( config.GetMapWidth(),config.GetMapHeight() ),
-	pFloorSurf( std::make_unique<Surface>( "Images\\floor.bmp" ) ),
-	pWallSurf( std::make_unique<Surface>( "Images\\wall.bmp" ) ),
-	pGoalSurf( std::make_unique<Surface>( "Images\\goal.bmp" ) ),
-	tileWidth( pFloorSurf->GetWidth() ),
-	tileHeight( pFloorSurf->GetHeight() ),
 	start_dir( (Direction::Type)std::uniform_int_distribution<int>{ 0,3 }( rng ) )
 {
 	assert( config.GetMapMode() == Config::MapMode::Procedural );
+	// generated unpacked with a wall sentinel border, so the neighbor checks that
+	// dominate generation are plain index offsets
+	Grid<TileType> work( config.GetMapWidth(),config.GetMapHeight(),TileType::Invalid,TileType::Wall );
+	Generate( config,rng,work );
+	this->tiles = PackedGrid<TileType>( work );
+}
+
+void TileMap::Generate( const Config& config,std::mt19937& rng,Grid<TileType>& tiles )
+{
+	if( config.GetGeneratorVersion() < 4 )
+	{
+		GenerateCompartments( config,config.GetMapRoomTries(),true,rng,tiles,start_pos );
+	}
+	else
+	{
+		GenerateRegions( config,rng,tiles );
+	}
+	// generate walls here (replace ?s)
+	for( Vei2 pos = { 0,0 }; pos.y < tiles.GetHeight(); pos.y++ )
+	{
+		for( pos.x = 0; pos.x < tiles.GetWidth(); pos.x++ )
+		{
+			if( tiles.At( pos ) == TileType::Invalid )
+			{
+				tiles.At( pos ) = TileType::Wall;
+			}
+		}
+	}
+	// extra doors
+	{
+		std::uniform_int_distribution<int> dist_x( 1,tiles.GetWidth() - 2 );
+		std::uniform_int_distribution<int> dist_y( 1,tiles.GetHeight() - 2 );
+		for( int n = 0; n < config.GetExtraDoors(); )
+		{
+			const Vei2 pos = { dist_x( rng ),dist_y( rng ) };
+			// a door has to open onto some floor (carving leaves every wall but
+			// generator 4's region lines next to one, so only those get skipped)
+			bool opensOntoFloor = false;
+			tiles.VisitNeighborIndices( tiles.GetIndex( pos ),[&tiles,&opensOntoFloor]( size_t n )
+			{
+				opensOntoFloor = opensOntoFloor || tiles[n] == TileType::Floor;
+			} );
+			if( tiles.At( pos ) == TileType::Wall && opensOntoFloor )
+			{
+				tiles.At( pos ) = TileType::Floor;
+				n++;
+			}
+		}
+	}
+	// (maybe generate flair here)
+	// if InView mode then don't worry about finding start
+	if( config.GetGoalMode() == Config::GoalMode::InView )
+	{
+		return;
+	}
+	// find random start pos
+	{
+		std::uniform_int_distribution<int> pos_dist_x( 0,tiles.GetWidth() - 1 );
+		std::uniform_int_distribution<int> pos_dist_y( 0,tiles.GetHeight() - 1 );
+		while( true )
+		{
+			const Vei2 pos = { pos_dist_x( rng ),pos_dist_y( rng ) };
+			if( tiles.At( pos ) == TileType::Floor )
+			{
+				start_pos = pos;
+				break;
+			}
+		}
+	}
+	// generate goal maybe if not alread done above
+	if( config.GetGoalMode() == Config::GoalMode::StartPosition )
+	{
+		tiles.At( start_pos ) = TileType::Goal;
+	}
+	else if( config.GetGoalMode() == Config::GoalMode::Random )
+	{
+		std::uniform_int_distribution<int> pos_dist_x( 0,tiles.GetWidth() - 1 );
+		std::uniform_int_distribution<int> pos_dist_y( 0,tiles.GetHeight() - 1 );
+		while( true )
+		{
+			const Vei2 pos = { pos_dist_x( rng ),pos_dist_y( rng ) };
+			if( tiles.At( pos ) == TileType::Floor )
+			{
+				tiles.At( pos ) = TileType::Goal;
+				break;
+			}
+		}
+	}
+}
+
+void TileMap::GenerateCompartments( const Config& config,int nRoomTries,bool placeGoalRoom,
+	std::mt19937& rng,Grid<TileType>& tiles,Vei2& startPos ) const
+{
 	// angle is in units of pi/2 (90deg you pleb)
 	const auto GetRotated90 = []( const Vei2& v,int angle )
 	{
@@ -139,13 +680,15 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 	const int min_room_size = 4;
 	const int max_room_size = 20;
 	std::uniform_int_distribution<int> room_dist( min_room_size,max_room_size );
-	Grid<int> compartmentIds( tiles.GetWidth(),tiles.GetHeight(),-1 );
+	Grid<int> compartmentIds( tiles.GetWidth(),tiles.GetHeight(),-1,-1 );
 	std::unordered_map<int,std::vector<Vei2>> compartments;
 	int cur_id = 0;
+	// room floors placed so far (the only cells that are not invalid until the corridors)
+	RoomIndex rooms( tiles.GetWidth(),tiles.GetHeight() );
 
 	// first place goal room if room mode active
-	if( config.GetGoalMode() == Config::GoalMode::RoomCenter ||
-		config.GetGoalMode() == Config::GoalMode::InView )
+	if( placeGoalRoom && (config.GetGoalMode() == Config::GoalMode::RoomCenter ||
+		config.GetGoalMode() == Config::GoalMode::InView) )
 	{
 		// goal room is 9x9 (could make this vary in the future)
 		const int width = 11;
@@ -163,28 +706,29 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 		{
 			for( pos.x = xLeft + 1; pos.x < xLeft + width - 1; pos.x++ )
 			{
-				tiles.At( pos ).type = TileType::Floor;
+				tiles.At( pos ) = TileType::Floor;
 				compartmentIds.At( pos ) = cur_id;
 				compartments[cur_id].push_back( pos );
 			}
 		}
+		rooms.Add( { xLeft + 1,xLeft + width - 1,yTop + 1,yTop + height - 1 } );
 		// place goal in one of two ways
 		if( config.GetGoalMode() == Config::GoalMode::RoomCenter )
 		{
-			tiles.At( Vei2{ xLeft,yTop } + Vei2{ 5,5 } ).type = TileType::Goal;
+			tiles.At( Vei2{ xLeft,yTop } + Vei2{ 5,5 } ) = TileType::Goal;
 		}
 		else // must be InView
 		{
 			// place chili first
-			start_pos = Vei2{ xLeft,yTop } + Vei2{ 5,5 };
+			startPos = Vei2{ xLeft,yTop } + Vei2{ 5,5 };
 			// then place goal
 			const int angle = std::bernoulli_distribution{}(rng) ? 1 : -1;
-			tiles.At( start_pos + start_dir + GetRotated90( start_dir,angle ) ).type = TileType::Goal;
+			tiles.At( startPos + start_dir + GetRotated90( start_dir,angle ) ) = TileType::Goal;
 		}
 		// update id
 		cur_id++;
 	}
-	else if( config.GetGoalMode() == Config::GoalMode::InView )
+	else if( placeGoalRoom && config.GetGoalMode() == Config::GoalMode::InView )
 	{
 		// goal room is 9x9 (could make this vary in the future)
 		const int width = 11;
@@ -202,18 +746,19 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 		{
 			for( pos.x = xLeft + 1; pos.x < xLeft + width - 1; pos.x++ )
 			{
-				tiles.At( pos ).type = TileType::Floor;
+				tiles.At( pos ) = TileType::Floor;
 				compartmentIds.At( pos ) = cur_id;
 				compartments[cur_id].push_back( pos );
 			}
 		}
+		rooms.Add( { xLeft + 1,xLeft + width - 1,yTop + 1,yTop + height - 1 } );
 		// place goal
-		tiles.At( Vei2{ xLeft,yTop } +Vei2{ 5,5 } ).type = TileType::Goal;
+		tiles.At( Vei2{ xLeft,yTop } +Vei2{ 5,5 } ) = TileType::Goal;
 		// update id
 		cur_id++;
 	}
 
-	const auto TryPlaceRoom = [this,&id = cur_id,&rng,&room_dist,&compartmentIds,&compartments]()
+	const auto TryPlaceRoom = [&tiles,&id = cur_id,&rng,&room_dist,&compartmentIds,&compartments,&rooms]()
 	{
 		const int width = room_dist( rng );
 		const int height = room_dist( rng );
@@ -223,15 +768,9 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 		const int xLeft = pos_dist_x( rng );
 		const int yTop = pos_dist_y( rng );
 		// check for overlap
-		for( Vei2 pos = { 0,yTop }; pos.y < yTop + height; pos.y++ )
+		if( !rooms.IsFree( { xLeft,xLeft + width,yTop,yTop + height } ) )
 		{
-			for( pos.x = xLeft; pos.x < xLeft + width; pos.x++ )
-			{
-				if( tiles.At( pos ).type != TileType::Invalid )
-				{
-					return false;
-				}
-			}
+			return false;
 		}
 		// add to compartment map
 		compartments.emplace( id,std::vector<Vei2>{} );
@@ -240,17 +779,18 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 		{
 			for( pos.x = xLeft + 1; pos.x < xLeft + width - 1; pos.x++ )
 			{
-				tiles.At( pos ).type = TileType::Floor;
+				tiles.At( pos ) = TileType::Floor;
 				compartmentIds.At( pos ) = id;
 				compartments[id].push_back( pos );
 			}
 		}
+		rooms.Add( { xLeft + 1,xLeft + width - 1,yTop + 1,yTop + height - 1 } );
 		// update id
 		id++;
 		return true;
 	};
 	// place rooms
-	for( int count = 0; count < config.GetMapRoomTries(); )
+	for( int count = 0; count < nRoomTries; )
 	{
 		if( !TryPlaceRoom() )
 		{
@@ -260,31 +800,29 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 	// generate surrounding walls
 	for( int x = 0; x < tiles.GetWidth(); x++ )
 	{
-		tiles.At( { x,0 } ).type = TileType::Wall;
-		tiles.At( { x,tiles.GetHeight() - 1 } ).type = TileType::Wall;
+		tiles.At( { x,0 } ) = TileType::Wall;
+		tiles.At( { x,tiles.GetHeight() - 1 } ) = TileType::Wall;
 	}
 	for( int y = 0; y < tiles.GetHeight(); y++ )
 	{
-		tiles.At( { 0,y } ).type = TileType::Wall;
-		tiles.At( { tiles.GetWidth() - 1,y } ).type = TileType::Wall;
+		tiles.At( { 0,y } ) = TileType::Wall;
+		tiles.At( { tiles.GetWidth() - 1,y } ) = TileType::Wall;
 	}
 	// generate corridors here
+	// tiles has a wall border, so every cell has 4 neighbors to look at
+	const auto CountNeighboring = [&tiles]( size_t i,TileType type )
 	{
-		const auto CountNeighboring = [this]( const Vei2& pos,TileType type )
+		int count = 0;
+		tiles.VisitNeighborIndices( i,[&tiles,&count,type]( size_t n )
 		{
-			// make sure tile has only 1 floor neighbor
-			int floorCount = 0;
-			VisitNeighbors( pos,
-				[this,&floorCount,type]( const Vei2& pos )
-			{
-				if( tiles.At( pos ).type == type )
-				{
-					floorCount++;
-				}
-			}
-			);
-			return floorCount;
-		};
+			count += int( tiles[n] == type );
+		} );
+		return count;
+	};
+	if( config.GetGeneratorVersion() < 2 )
+	{
+		// generator 1: each corridor is a random walk from a seed cell that stops
+		// at its first dead end, the grid is rescanned for seeds until none are left
 		bool finished = false;
 		while( !finished )
 		{
@@ -294,23 +832,23 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 				for( pos.x = 0; pos.x < tiles.GetWidth(); pos.x++ )
 				{
 					// must have no neighbor floors
-					if( tiles.At( pos ).type == TileType::Invalid &&
-						CountNeighboring( pos,TileType::Floor ) == 0 )
+					if( tiles.At( pos ) == TileType::Invalid &&
+						CountNeighboring( tiles.GetIndex( pos ),TileType::Floor ) == 0 )
 					{
 						finished = false;
 						std::vector<Vei2> cands;
-						tiles.At( pos ).type = TileType::Floor;
+						tiles.At( pos ) = TileType::Floor;
 						compartmentIds.At( pos ) = cur_id;
-						const auto AddCands = [this,&cands,CountNeighboring,&rng]( const Vei2& pos )
+						const auto AddCands = [&tiles,&cands,CountNeighboring]( const Vei2& pos )
 						{
 							cands.clear();
-							VisitNeighbors( pos,
-								[this,&cands,CountNeighboring]( const Vei2& pos )
+							tiles.VisitNeighborIndices( tiles.GetIndex( pos ),
+								[&tiles,&cands,CountNeighboring]( size_t n )
 							{
-								if( tiles.At( pos ).type == TileType::Invalid &&
-									CountNeighboring( pos,TileType::Floor ) == 1 )
+								if( tiles[n] == TileType::Invalid &&
+									CountNeighboring( n,TileType::Floor ) == 1 )
 								{
-									cands.emplace_back( pos );
+									cands.emplace_back( tiles.GetPos( n ) );
 								}
 							}
 							);
@@ -321,7 +859,7 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 						{
 							std::uniform_int_distribution<int> cdist( 0,(int)cands.size() - 1 );
 							pos = cands[cdist( rng )];
-							tiles.At( pos ).type = TileType::Floor;
+							tiles.At( pos ) = TileType::Floor;
 							compartments[cur_id].push_back( pos );
 							compartmentIds.At( pos ) = cur_id;
 							AddCands( pos );
@@ -332,143 +870,351 @@ TileMap::TileMap( const Config& config,std::mt19937& rng )
 			}
 		}
 	}
+	else
+	{
+		// generator 2: a single pass over the grid seeds a corridor in every cell
+		// with no floor around it (carving only ever adds floor, so a cell passed
+		// over never becomes a seed later); a corridor grows from a random cell of
+		// its whole frontier, the invalid cells next to exactly one floor, which
+		// is kept up to date as cells are carved, so the phase is linear in cells
+		std::vector<size_t> frontier;
+		// position of each cell in frontier, -1 if it is not in it
+		Grid<int> slots( tiles.GetWidth(),tiles.GetHeight(),-1,-1 );
+		const auto Remove = [&frontier,&slots]( size_t i )
+		{
+			const int slot = slots[i];
+			if( slot >= 0 )
+			{
+				slots[frontier.back()] = slot;
+				frontier[slot] = frontier.back();
+				frontier.pop_back();
+				slots[i] = -1;
+			}
+		};
+		const auto Carve = [&]( size_t i )
+		{
+			Remove( i );
+			tiles[i] = TileType::Floor;
+			compartmentIds[i] = cur_id;
+			compartments[cur_id].push_back( tiles.GetPos( i ) );
+			tiles.VisitNeighborIndices( i,[&]( size_t n )
+			{
+				if( tiles[n] == TileType::Invalid )
+				{
+					// i was the first floor next to n, or n now touches two floors
+					const int nFloors = CountNeighboring( n,TileType::Floor );
+					if( nFloors == 1 )
+					{
+						slots[n] = (int)frontier.size();
+						frontier.push_back( n );
+					}
+					else if( nFloors == 2 )
+					{
+						Remove( n );
+					}
+				}
+			} );
+		};
+		for( int y = 0; y < tiles.GetHeight(); y++ )
+		{
+			for( int x = 0; x < tiles.GetWidth(); x++ )
+			{
+				const auto seed = tiles.GetIndex( x,y );
+				if( tiles[seed] != TileType::Invalid || CountNeighboring( seed,TileType::Floor ) != 0 )
+				{
+					continue;
+				}
+				Carve( seed );
+				while( !frontier.empty() )
+				{
+					Carve( frontier[std::uniform_int_distribution<size_t>{ 0,frontier.size() - 1 }( rng )] );
+				}
+				cur_id++;
+			}
+		}
+	}
 	// last compartment is empty
 	compartments.erase( cur_id-- );
 	// TODO: assert no empty compartments
 	// generate linking doors here
-	while( compartments.size() > 1 )
-	{
-		std::vector<Vei2> wall_cands;
-		const int off = std::uniform_int_distribution<int>{ 0,(int)compartments.size() - 1 }(rng);
-		const int iMerge = std::next( compartments.begin(),off )->first;
-		auto& merging = compartments[iMerge];
-		std::shuffle( merging.begin(),merging.end(),rng );
-		// DoorTile: tile in comp that connects to door
-		int iDoorTile = 0;
-		for( ; iDoorTile < merging.size(); iDoorTile++ )
-		{
-			compartmentIds.VisitNeighbors( merging[iDoorTile],
-				[&wall_cands,this]( const Vei2& pos )
+	if( config.GetGeneratorVersion() < 3 )
+	{
+		// generator 1 and 2: a random compartment opens a door to whatever borders
+		// it, its tiles are shuffled and rescanned and the merged ones relabeled
+		while( compartments.size() > 1 )
+		{
+			std::vector<Vei2> wall_cands;
+			const int off = std::uniform_int_distribution<int>{ 0,(int)compartments.size() - 1 }(rng);
+			const int iMerge = std::next( compartments.begin(),off )->first;
+			auto& merging = compartments[iMerge];
+			std::shuffle( merging.begin(),merging.end(),rng );
+			// DoorTile: tile in comp that connects to door
+			int iDoorTile = 0;
+			for( ; iDoorTile < merging.size(); iDoorTile++ )
 			{
-				if( tiles.At( pos ).type == TileType::Invalid )
+				compartmentIds.VisitNeighbors( merging[iDoorTile],
+					[&wall_cands,&tiles]( const Vei2& pos )
 				{
-					wall_cands.push_back( pos );
+					if( tiles.At( pos ) == TileType::Invalid )
+					{
+						wall_cands.push_back( pos );
+					}
 				}
+				);
 			}
-			);
-		}
-		// find first candidate that borders a different compartment
-		std::vector<Vei2> mergable_neighbors;
-		while( !wall_cands.empty() )
-		{
-			//Save( "debug.txt" );
-			// maybe just get a list of non-merge neighbors
-			const auto cur_wall_cand = wall_cands.back();
-			compartmentIds.VisitNeighbors( cur_wall_cand,
-				[&mergable_neighbors,iMerge,&compartmentIds]( const Vei2& p )
+			// find first candidate that borders a different compartment
+			std::vector<Vei2> mergable_neighbors;
+			while( !wall_cands.empty() )
 			{
-				const int t = compartmentIds.At( p );
-				if( t != -1 && t != iMerge )
+				//Save( "debug.txt" );
+				// maybe just get a list of non-merge neighbors
+				const auto cur_wall_cand = wall_cands.back();
+				compartmentIds.VisitNeighbors( cur_wall_cand,
+					[&mergable_neighbors,iMerge,&compartmentIds]( const Vei2& p )
 				{
-					if( std::find_if( mergable_neighbors.begin(),mergable_neighbors.end(),
-						[t,&compartmentIds]( const Vei2& pos )
+					const int t = compartmentIds.At( p );
+					if( t != -1 && t != iMerge )
 					{
-						return t == compartmentIds.At( pos );
+						if( std::find_if( mergable_neighbors.begin(),mergable_neighbors.end(),
+							[t,&compartmentIds]( const Vei2& pos )
+						{
+							return t == compartmentIds.At( pos );
+						}
+							) == mergable_neighbors.end() )
+						{
+							mergable_neighbors.push_back( p );
+						}
 					}
-						) == mergable_neighbors.end() )
+				}
+				);
+				if( mergable_neighbors.size() != 0 )
+				{
+					// merge with all neighbors (take iMerge)
+					for( const auto& vm : mergable_neighbors )
 					{
-						mergable_neighbors.push_back( p );
+						const int i = compartmentIds.At( vm );
+						for( auto& p : compartments[i] )
+						{
+							compartmentIds.At( p ) = iMerge;
+						}
+						merging.insert( merging.end(),
+							compartments[i].begin(),compartments[i].end()
+						);
+						compartments.erase( i );
 					}
+					// remove wall and add floor (iMerge)
+					compartmentIds.At( wall_cands.back() ) = iMerge;
+					tiles.At( wall_cands.back() ) = TileType::Floor;
+					// empty wall_cands
+					wall_cands.clear();
+				}
+				else
+				{
+					mergable_neighbors.clear();
+					wall_cands.pop_back();
 				}
 			}
-			);
-			if( mergable_neighbors.size() != 0 )
+		}
+	}
+	else
+	{
+		// generator 3: kruskal over a disjoint set of compartments; every invalid
+		// cell between two or more compartments is collected once and shuffled
+		// once, then each one that still separates distinct sets becomes a door
+		DisjointSet sets( cur_id + 1 );
+		// compartmentIds is padded like tiles, so indices carry over
+		std::vector<size_t> doors;
+		for( int y = 0; y < tiles.GetHeight(); y++ )
+		{
+			for( int x = 0; x < tiles.GetWidth(); x++ )
 			{
-				// merge with all neighbors (take iMerge)
-				for( const auto& vm : mergable_neighbors )
+				const auto i = tiles.GetIndex( x,y );
+				if( tiles[i] != TileType::Invalid )
+				{
+					continue;
+				}
+				int first = -1;
+				bool between = false;
+				compartmentIds.VisitNeighborIndices( i,[&]( size_t n )
 				{
-					const int i = compartmentIds.At( vm );
-					for( auto& p : compartments[i] )
+					const int id = compartmentIds[n];
+					if( id != -1 )
 					{
-						compartmentIds.At( p ) = iMerge;
+						between = between || (first != -1 && id != first);
+						first = first == -1 ? id : first;
 					}
-					merging.insert( merging.end(),
-						compartments[i].begin(),compartments[i].end()
-					);
-					compartments.erase( i );
+				} );
+				if( between )
+				{
+					doors.push_back( i );
 				}
-				// remove wall and add floor (iMerge)
-				compartmentIds.At( wall_cands.back() ) = iMerge;
-				tiles.At( wall_cands.back() ).type = TileType::Floor;
-				// empty wall_cands
-				wall_cands.clear();
 			}
-			else
+		}
+		std::shuffle( doors.begin(),doors.end(),rng );
+		int nSets = (int)compartments.size();
+		for( auto d = doors.cbegin(); d != doors.cend() && nSets > 1; ++d )
+		{
+			int root = -1;
+			compartmentIds.VisitNeighborIndices( *d,[&]( size_t n )
 			{
-				mergable_neighbors.clear();
-				wall_cands.pop_back();
-			}
+				if( compartmentIds[n] == -1 )
+				{
+					return;
+				}
+				const int r = sets.Find( compartmentIds[n] );
+				if( root == -1 )
+				{
+					root = r;
+				}
+				else if( r != root )
+				{
+					// first join opens the door, every join merges one set away
+					tiles[*d] = TileType::Floor;
+					compartmentIds[*d] = root;
+					sets.Link( root,r );
+					nSets--;
+				}
+			} );
+		}
+		if( nSets > 1 )
+		{
+			ConnectFloor( tiles );
 		}
 	}
-	// generate walls here (replace ?s)
-	for( auto& t : tiles )
+}
+
+void TileMap::GenerateRegions( const Config& config,std::mt19937& rng,Grid<TileType>& tiles )
+{
+	// generator 4: wall lines split the map into a grid of regions; each region
+	// gets rooms, corridors and doors like a generator 3 map with the lines as its
+	// border, from a seed drawn up front (so the map does not depend on how many
+	// threads there are), then a stitching pass opens doors in the lines
+	const auto GetLines = []( int length )
 	{
-		if( t.type == TileType::Invalid )
+		// first and last line are the map border
+		const int n = std::max( (length - 1) / regionSize,1 );
+		std::vector<int> lines( (size_t)n + 1 );
+		for( int k = 0; k <= n; k++ )
 		{
-			t.type = TileType::Wall;
+			lines[k] = int( (long long)k * (length - 1) / n );
 		}
+		return lines;
+	};
+	const auto xLines = GetLines( tiles.GetWidth() );
+	const auto yLines = GetLines( tiles.GetHeight() );
+	const int nx = (int)xLines.size() - 1;
+	const int ny = (int)yLines.size() - 1;
+	const int nRegions = nx * ny;
+	const bool hasGoalRoom = config.GetGoalMode() == Config::GoalMode::RoomCenter ||
+		config.GetGoalMode() == Config::GoalMode::InView;
+	const int goalRegion = hasGoalRoom ? std::uniform_int_distribution<int>{ 0,nRegions - 1 }( rng ) : -1;
+	std::vector<std::mt19937::result_type> seeds( (size_t)nRegions );
+	for( auto& s : seeds )
+	{
+		s = rng();
 	}
-	// extra doors
+	// room tries are shared out by area, so rooms are as dense as in one big map
+	const long long mapArea = (long long)(tiles.GetWidth() - 2) * (tiles.GetHeight() - 2);
+	Vei2 goalStart = { 0,0 };
+	const auto GenerateRegion = [&]( int r )
 	{
-		std::uniform_int_distribution<int> dist_x( 1,tiles.GetWidth() - 2 );
-		std::uniform_int_distribution<int> dist_y( 1,tiles.GetHeight() - 2 );
-		for( int n = 0; n < config.GetExtraDoors(); )
+		const int x0 = xLines[r % nx];
+		const int x1 = xLines[r % nx + 1];
+		const int y0 = yLines[r / nx];
+		const int y1 = yLines[r / nx + 1];
+		Grid<TileType> region( x1 - x0 + 1,y1 - y0 + 1,TileType::Invalid,TileType::Wall );
+		const long long area = (long long)(x1 - x0 - 1) * (y1 - y0 - 1);
+		const int nRoomTries = int( (config.GetMapRoomTries() * area + mapArea / 2) / mapArea );
+		std::mt19937 regionRng( seeds[r] );
+		Vei2 regionStart = { 0,0 };
+		GenerateCompartments( config,nRoomTries,r == goalRegion,regionRng,region,regionStart );
+		if( r == goalRegion )
 		{
-			const Vei2 pos = { dist_x( rng ),dist_y( rng ) };
-			if( tiles.At( pos ).type == TileType::Wall )
-			{
-				tiles.At( pos ).type = TileType::Floor;
-				n++;
-			}
+			goalStart = regionStart + Vei2{ x0,y0 };
+		}
+		// only the inside, the lines are shared with the neighbors
+		for( int y = 1; y < region.GetHeight() - 1; y++ )
+		{
+			std::copy( &region.At( 1,y ),&region.At( region.GetWidth() - 1,y ),&tiles.At( x0 + 1,y0 + y ) );
+		}
+	};
+	const int nThreads = std::min( config.GetNumberRegionThreads(),nRegions );
+	if( nThreads > 1 )
+	{
+		ThreadPool pool( nThreads );
+		for( int r = 0; r < nRegions; r++ )
+		{
+			pool.Submit( [&GenerateRegion,r]() { GenerateRegion( r ); } );
+		}
+		pool.Wait();
+	}
+	else
+	{
+		for( int r = 0; r < nRegions; r++ )
+		{
+			GenerateRegion( r );
 		}
 	}
-	// (maybe generate flair here)
-	// if InView mode then don't worry about finding start
 	if( config.GetGoalMode() == Config::GoalMode::InView )
 	{
-		return;
+		start_pos = goalStart;
 	}
-	// find random start pos
+
+	// stitching: kruskal over the regions, every line cell with floor on both
+	// sides is a candidate door between the two regions it separates
+	struct Door
 	{
-		std::uniform_int_distribution<int> pos_dist_x( 0,tiles.GetWidth() - 1 );
-		std::uniform_int_distribution<int> pos_dist_y( 0,tiles.GetHeight() - 1 );
-		while( true )
+		size_t index;
+		int a;
+		int b;
+	};
+	std::vector<Door> doors;
+	for( int k = 1; k < nx; k++ )
+	{
+		const int x = xLines[k];
+		for( int j = 0; j < ny; j++ )
 		{
-			const Vei2 pos = { pos_dist_x( rng ),pos_dist_y( rng ) };
-			if( tiles.At( pos ).type == TileType::Floor )
+			for( int y = yLines[j] + 1; y < yLines[j + 1]; y++ )
 			{
-				start_pos = pos;
-				break;
+				if( tiles.At( x - 1,y ) == TileType::Floor && tiles.At( x + 1,y ) == TileType::Floor )
+				{
+					doors.push_back( { tiles.GetIndex( x,y ),j * nx + k - 1,j * nx + k } );
+				}
 			}
 		}
 	}
-	// generate goal maybe if not alread done above
-	if( config.GetGoalMode() == Config::GoalMode::StartPosition )
-	{
-		tiles.At( start_pos ).type = TileType::Goal;
-	}
-	else if( config.GetGoalMode() == Config::GoalMode::Random )
+	for( int k = 1; k < ny; k++ )
 	{
-		std::uniform_int_distribution<int> pos_dist_x( 0,tiles.GetWidth() - 1 );
-		std::uniform_int_distribution<int> pos_dist_y( 0,tiles.GetHeight() - 1 );
-		while( true )
+		const int y = yLines[k];
+		for( int i = 0; i < nx; i++ )
 		{
-			auto& tile = tiles.At( { pos_dist_x( rng ),pos_dist_y( rng ) } );
-			if( tile.type == TileType::Floor )
+			for( int x = xLines[i] + 1; x < xLines[i + 1]; x++ )
 			{
-				tile.type = TileType::Goal;
-				break;
+				if( tiles.At( x,y - 1 ) == TileType::Floor && tiles.At( x,y + 1 ) == TileType::Floor )
+				{
+					doors.push_back( { tiles.GetIndex( x,y ),(k - 1) * nx + i,k * nx + i } );
+				}
 			}
 		}
 	}
-}
+	std::shuffle( doors.begin(),doors.end(),rng );
+	DisjointSet sets( nRegions );
+	int nSets = nRegions;
+	for( auto d = doors.cbegin(); d != doors.cend() && nSets > 1; ++d )
+	{
+		const int a = sets.Find( d->a );
+		const int b = sets.Find( d->b );
+		if( a != b )
+		{
+			tiles[d->index] = TileType::Floor;
+			sets.Link( a,b );
+			nSets--;
+		}
+	}
+	// two neighbors without a line cell that has floor on both sides
+	if( nSets > 1 )
+	{
+		ConnectFloor( tiles );
+	}
+	// the other line cells are still invalid and become walls with the rest
+}
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
-#include "Surface.h"
+#ifndef ROBOMAZE_HEADLESS
+#include "Assets.h"
 #include "Graphics.h"
 #include "SpriteEffect.h"
+#endif
 #include "Direction.h"
+#include "Colors.h"
+#include "Rect.h"
+#include <cassert>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <sstream>
@@ -128,23 +134,232 @@ private:
 	Camera& cam;
 };
 
-template<typename T>
+// storage layouts for Grid, each maps cell (x,y) of a width x height area onto
+// an index into the grid's vector and back
+// rows one after the other: only horizontal neighbors share a cache line
+class RowMajorLayout
+{
+public:
+	RowMajorLayout() = default;
+	RowMajorLayout( int width,int height )
+		:
+		width( width ),
+		height( height )
+	{}
+	size_t GetSize() const
+	{
+		return (size_t)width * height;
+	}
+	size_t GetIndex( int x,int y ) const
+	{
+		return (size_t)y * width + x;
+	}
+	Vei2 GetPos( size_t index ) const
+	{
+		return { int( index % width ),int( index / width ) };
+	}
+	// F: void(size_t), up / right / down / left of index (all four must exist)
+	template<typename F>
+	void VisitNeighborIndices( size_t index,F f ) const
+	{
+		f( index - width );
+		f( index + 1 );
+		f( index + width );
+		f( index - 1 );
+	}
+private:
+	int width = 0;
+	int height = 0;
+};
+
+// 8 x 8 tiles stored one after the other (tiles in row major order, cells row
+// major inside a tile), so a vertical step stays inside the tile 7 times in 8
+// storage is rounded up to whole tiles
+class TiledLayout
+{
+public:
+	static constexpr int tileShift = 3;
+	static constexpr int tileSize = 1 << tileShift;
+	static constexpr int tileMask = tileSize - 1;
+public:
+	TiledLayout() = default;
+	TiledLayout( int width,int height )
+		:
+		tilesPerRow( (width + tileMask) >> tileShift ),
+		nTileRows( (height + tileMask) >> tileShift )
+	{}
+	size_t GetSize() const
+	{
+		return (size_t)tilesPerRow * nTileRows * tileSize * tileSize;
+	}
+	size_t GetIndex( int x,int y ) const
+	{
+		const size_t tile = (size_t)(y >> tileShift) * tilesPerRow + (x >> tileShift);
+		return (tile << (2 * tileShift)) | (size_t)((y & tileMask) << tileShift) | (size_t)(x & tileMask);
+	}
+	Vei2 GetPos( size_t index ) const
+	{
+		const size_t tile = index >> (2 * tileShift);
+		const int cell = int( index & (tileSize * tileSize - 1) );
+		return {
+			int( tile % tilesPerRow ) * tileSize + (cell & tileMask),
+			int( tile / tilesPerRow ) * tileSize + (cell >> tileShift)
+		};
+	}
+	// F: void(size_t), up / right / down / left of index (all four must exist)
+	// only a step across a tile edge needs more than +-1 / +-tileSize
+	template<typename F>
+	void VisitNeighborIndices( size_t index,F f ) const
+	{
+		const size_t tileCells = tileSize * tileSize;
+		const size_t tileRowCells = tileCells * tilesPerRow;
+		const int cx = int( index & tileMask );
+		const int cy = int( (index >> tileShift) & tileMask );
+		f( cy != 0 ? index - tileSize : index + tileCells - tileSize - tileRowCells );
+		f( cx != tileMask ? index + 1 : index + tileCells - tileMask );
+		f( cy != tileMask ? index + tileSize : index - (tileCells - tileSize) + tileRowCells );
+		f( cx != 0 ? index - 1 : index - tileCells + tileMask );
+	}
+private:
+	int tilesPerRow = 0;
+	int nTileRows = 0;
+};
+
+// z-order: the bits of x and y interleaved, so cells close in both directions
+// are close in memory at every scale; both sides are rounded up to a power of
+// two, and when they differ the extra high bits of the longer side go on top
+// (a stack of morton squares), which keeps storage at most 4x width * height
+class MortonLayout
+{
+public:
+	MortonLayout() = default;
+	MortonLayout( int width,int height )
+		:
+		xBits( GetBitCount( width ) ),
+		yBits( GetBitCount( height ) ),
+		lowBits( std::min( xBits,yBits ) )
+	{
+		const uint64_t low = lowBits != 0 ? ~uint64_t( 0 ) >> (64 - 2 * lowBits) : 0u;
+		const uint64_t high = ((uint64_t( 1 ) << (xBits + yBits)) - 1u) & ~low;
+		xMask = (low & 0x5555555555555555u) | (xBits > yBits ? high : 0u);
+		yMask = (low & 0xAAAAAAAAAAAAAAAAu) | (xBits > yBits ? 0u : high);
+	}
+	size_t GetSize() const
+	{
+		return size_t( 1 ) << (xBits + yBits);
+	}
+	size_t GetIndex( int x,int y ) const
+	{
+		const uint32_t lowMask = (uint32_t( 1 ) << lowBits) - 1u;
+		return size_t(
+			Spread( uint32_t( x ) & lowMask ) |
+			(Spread( uint32_t( y ) & lowMask ) << 1) |
+			(uint64_t( uint32_t( x | y ) >> lowBits ) << (2 * lowBits)) );
+	}
+	Vei2 GetPos( size_t index ) const
+	{
+		const uint64_t z = index;
+		const uint64_t low = z & ((uint64_t( 1 ) << (2 * lowBits)) - 1u);
+		const int high = int( z >> (2 * lowBits) ) << lowBits;
+		const int x = int( Compact( low ) );
+		const int y = int( Compact( low >> 1 ) );
+		return xBits > yBits ? Vei2{ x | high,y } : Vei2{ x,y | high };
+	}
+	// F: void(size_t), up / right / down / left of index (all four must exist)
+	// steps one coordinate by +-1 right in the interleaved index: filling the
+	// other coordinate's bits with ones (or clearing them) lets the carry / borrow
+	// ripple straight through them
+	template<typename F>
+	void VisitNeighborIndices( size_t index,F f ) const
+	{
+		const uint64_t z = index;
+		const uint64_t zx = z & xMask;
+		const uint64_t zy = z & yMask;
+		f( size_t( ((zy - 1u) & yMask) | zx ) );
+		f( size_t( (((z | yMask) + 1u) & xMask) | zy ) );
+		f( size_t( (((z | xMask) + 1u) & yMask) | zx ) );
+		f( size_t( ((zx - 1u) & xMask) | zy ) );
+	}
+private:
+	static int GetBitCount( int n )
+	{
+		int bits = 0;
+		while( (1 << bits) < n )
+		{
+			bits++;
+		}
+		return bits;
+	}
+	// bit i of v to bit 2i
+	static uint64_t Spread( uint32_t v )
+	{
+		uint64_t r = v;
+		r = (r | (r << 16)) & 0x0000FFFF0000FFFFu;
+		r = (r | (r << 8)) & 0x00FF00FF00FF00FFu;
+		r = (r | (r << 4)) & 0x0F0F0F0F0F0F0F0Fu;
+		r = (r | (r << 2)) & 0x3333333333333333u;
+		r = (r | (r << 1)) & 0x5555555555555555u;
+		return r;
+	}
+	// bit 2i of v to bit i
+	static uint32_t Compact( uint64_t v )
+	{
+		v &= 0x5555555555555555u;
+		v = (v | (v >> 1)) & 0x3333333333333333u;
+		v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Fu;
+		v = (v | (v >> 4)) & 0x00FF00FF00FF00FFu;
+		v = (v | (v >> 8)) & 0x0000FFFF0000FFFFu;
+		v = (v | (v >> 16)) & 0x00000000FFFFFFFFu;
+		return uint32_t( v );
+	}
+private:
+	int xBits = 0;
+	int yBits = 0;
+	int lowBits = 0;
+	uint64_t xMask = 0u;
+	uint64_t yMask = 0u;
+};
+
+// cells stored by a Layout policy (row major by default), optionally surrounded
+// by a one cell border of sentinel values; At() is the same for every layout,
+// only which neighbors share cache lines changes
+// on a padded grid neighbors are found from the storage index alone and never
+// need a bounds check, the border just reads as the sentinel
+// cells the layout rounds up for (tiled / morton) are storage only and never visited
+template<typename T,typename Layout = RowMajorLayout>
 class Grid : public std::vector<T>
 {
 public:
 	Grid() = default;
 	Grid( int width,int height )
 		:
-		vector( width*height ),
-		width( width ),
-		height( height )
+		Grid( width,height,T{} )
 	{}
 	Grid( int width,int height,const T& val )
 		:
-		vector( width*height,val ),
 		width( width ),
-		height( height )
-	{}
+		height( height ),
+		layout( width,height )
+	{
+		this->assign( layout.GetSize(),val );
+	}
+	// padded grid, cells outside the width x height area (x or y of -1 / width / height) hold sentinel
+	Grid( int width,int height,const T& val,const T& sentinel )
+		:
+		width( width ),
+		height( height ),
+		pad( 1 ),
+		layout( width + 2,height + 2 )
+	{
+		this->assign( layout.GetSize(),sentinel );
+		for( int y = 0; y < height; y++ )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				At( x,y ) = val;
+			}
+		}
+	}
 	int GetWidth() const
 	{
 		return width;
@@ -165,10 +380,28 @@ public:
 	{
 		return const_cast<Grid*>(this)->At( x,y );
 	}
+	// the border of a padded grid can be read (and written) too
 	T& At( int x,int y )
 	{
-		assert( Contains( { x,y } ) );
-		return (*this)[x + y * width];
+		assert( x >= -pad && x < width + pad && y >= -pad && y < height + pad );
+		return (*this)[GetIndex( x,y )];
+	}
+	// storage index of a cell, for operator[] and VisitNeighborIndices
+	size_t GetIndex( int x,int y ) const
+	{
+		return layout.GetIndex( x + pad,y + pad );
+	}
+	size_t GetIndex( const Vei2& pos ) const
+	{
+		return GetIndex( pos.x,pos.y );
+	}
+	Vei2 GetPos( size_t index ) const
+	{
+		return layout.GetPos( index ) - Vei2{ pad,pad };
+	}
+	bool IsPadded() const
+	{
+		return pad != 0;
 	}
 	bool Contains( const Vei2& pos ) const
 	{
@@ -183,26 +416,34 @@ public:
 			y < height;
 	}
 	// F: void(cVei2&)
+	// padded grids also visit border cells, unpadded ones skip what is outside
 	template<typename F>
-	void VisitNeighbors( const Vei2& pos,F f )
+	void VisitNeighbors( const Vei2& pos,F f ) const
 	{
-		auto dir = Direction::Up();
-		for( int i = 0; i < 4; i++,dir.RotateClockwise() )
+		for( int i = 0; i < 4; i++ )
 		{
-			const auto p = pos + dir;
-			if( Contains( p ) )
+			const Vei2 p = { pos.x + neighborDx[i],pos.y + neighborDy[i] };
+			if( pad != 0 || Contains( p ) )
 			{
 				f( p );
 			}
 		}
 	}
+	// padded grids only, F: void(size_t) gets the storage index of each neighbor
+	// (same order as VisitNeighbors)
+	template<typename F>
+	void VisitNeighborIndices( size_t index,F f ) const
+	{
+		assert( IsPadded() );
+		layout.VisitNeighborIndices( index,f );
+	}
 	// C: bool(cT&)
 	template<typename C>
 	int CountNeighbors( const Vei2& pos,C comp ) const
 	{
 		int count = 0;
 		VisitNeighbors( pos,
-			[this,comp]( const Vei2& pos )
+			[this,comp,&count]( const Vei2& pos )
 			{
 				if( comp( At( pos ) ) )
 				{
@@ -215,6 +456,267 @@ public:
 private:
 	int width = -1;
 	int height = -1;
+	int pad = 0;
+	Layout layout;
+};
+
+// same interface as Grid, but cells live in pageSize x pageSize pages that are
+// only allocated when a cell in them is first written through the non-const At()
+// reading an untouched cell (const At()) gives the fill value without allocating,
+// so memory follows the touched area instead of width * height; the page table
+// itself is a row of pages per pageSize map rows, also only allocated when touched
+template<typename T>
+class ChunkedGrid
+{
+public:
+	static constexpr int pageShift = 6;
+	static constexpr int pageSize = 1 << pageShift;
+public:
+	ChunkedGrid() = default;
+	ChunkedGrid( int width,int height,const T& fill = T{} )
+		:
+		width( width ),
+		height( height ),
+		pagesPerRow( (width + pageSize - 1) >> pageShift ),
+		pageRows( (size_t)(height + pageSize - 1) >> pageShift ),
+		fill( fill )
+	{}
+	int GetWidth() const
+	{
+		return width;
+	}
+	int GetHeight() const
+	{
+		return height;
+	}
+	const T& At( const Vei2& pos ) const
+	{
+		return At( pos.x,pos.y );
+	}
+	T& At( const Vei2& pos )
+	{
+		return At( pos.x,pos.y );
+	}
+	const T& At( int x,int y ) const
+	{
+		assert( Contains( x,y ) );
+		const auto& row = pageRows[y >> pageShift];
+		if( row.empty() )
+		{
+			return fill;
+		}
+		const auto& page = row[x >> pageShift];
+		return page.empty() ? fill : page[GetCellIndex( x,y )];
+	}
+	T& At( int x,int y )
+	{
+		assert( Contains( x,y ) );
+		auto& row = pageRows[y >> pageShift];
+		if( row.empty() )
+		{
+			row.resize( (size_t)pagesPerRow );
+		}
+		auto& page = row[x >> pageShift];
+		if( page.empty() )
+		{
+			page.assign( pageSize * pageSize,fill );
+		}
+		return page[GetCellIndex( x,y )];
+	}
+	bool Contains( const Vei2& pos ) const
+	{
+		return Contains( pos.x,pos.y );
+	}
+	bool Contains( int x,int y ) const
+	{
+		return
+			x >= 0 &&
+			x < width &&
+			y >= 0 &&
+			y < height;
+	}
+	// F: void(cVei2&)
+	template<typename F>
+	void VisitNeighbors( const Vei2& pos,F f ) const
+	{
+		for( int i = 0; i < 4; i++ )
+		{
+			const Vei2 p = { pos.x + neighborDx[i],pos.y + neighborDy[i] };
+			if( Contains( p ) )
+			{
+				f( p );
+			}
+		}
+	}
+	// number of allocated pages (for memory stats)
+	size_t GetPageCount() const
+	{
+		size_t count = 0;
+		for( const auto& row : pageRows )
+		{
+			count += (size_t)std::count_if( row.begin(),row.end(),
+				[]( const std::vector<T>& page ) { return !page.empty(); }
+			);
+		}
+		return count;
+	}
+private:
+	static int GetCellIndex( int x,int y )
+	{
+		return ((y & (pageSize - 1)) << pageShift) | (x & (pageSize - 1));
+	}
+private:
+	int width = 0;
+	int height = 0;
+	int pagesPerRow = 0;
+	// rows and pages both empty until touched
+	std::vector<std::vector<std::vector<T>>> pageRows;
+	T fill = T{};
+};
+
+// 2 bits per cell for small enums (at most 4 values), rows padded to whole
+// 64 bit words so a row never shares a word with the next one
+// 1000x1000 cells take 250KB instead of the 8MB of a Grid of structs
+// the words are either owned or a read-only view of memory kept alive by
+// someone else (a mapped file), At() reads both the same way
+template<typename T>
+class PackedGrid
+{
+public:
+	static constexpr int bitsPerCell = 2;
+	static constexpr int cellsPerWord = 64 / bitsPerCell;
+public:
+	PackedGrid() = default;
+	PackedGrid( int width,int height,const T& val )
+		:
+		width( width ),
+		height( height ),
+		wordsPerRow( GetWordsPerRow( width ) ),
+		words( (size_t)wordsPerRow * height,Fill( val ) ),
+		pWords( words.data() )
+	{}
+	// takes over words already in the Data() layout
+	PackedGrid( int width,int height,std::vector<uint64_t> words_in )
+		:
+		width( width ),
+		height( height ),
+		wordsPerRow( GetWordsPerRow( width ) ),
+		words( std::move( words_in ) ),
+		pWords( words.data() )
+	{
+		assert( words.size() == (size_t)wordsPerRow * height );
+	}
+	// wraps pWords (GetWordsPerRow( width ) * height words in the layout Data()
+	// returns) without copying, owner keeps the memory alive for every copy
+	PackedGrid( int width,int height,const uint64_t* pWords,std::shared_ptr<const void> owner )
+		:
+		width( width ),
+		height( height ),
+		wordsPerRow( GetWordsPerRow( width ) ),
+		pWords( pWords ),
+		owner( std::move( owner ) )
+	{}
+	PackedGrid( const PackedGrid& src )
+		:
+		width( src.width ),
+		height( src.height ),
+		wordsPerRow( src.wordsPerRow ),
+		words( src.words ),
+		pWords( src.owner ? src.pWords : words.data() ),
+		owner( src.owner )
+	{}
+	// moving a vector keeps its buffer, so pWords stays valid
+	PackedGrid( PackedGrid&& ) = default;
+	PackedGrid& operator=( const PackedGrid& rhs )
+	{
+		return *this = PackedGrid( rhs );
+	}
+	PackedGrid& operator=( PackedGrid&& ) = default;
+	explicit PackedGrid( const Grid<T>& grid )
+		:
+		PackedGrid( grid.GetWidth(),grid.GetHeight(),T{} )
+	{
+		for( int y = 0; y < height; y++ )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				Set( x,y,grid.At( x,y ) );
+			}
+		}
+	}
+	int GetWidth() const
+	{
+		return width;
+	}
+	int GetHeight() const
+	{
+		return height;
+	}
+	static int GetWordsPerRow( int width )
+	{
+		return (width + cellsPerWord - 1) / cellsPerWord;
+	}
+	// raw rows, cell x of row y in bits x % cellsPerWord * bitsPerCell of word
+	// y * GetWordsPerRow( width ) + x / cellsPerWord (padding cells are don't care)
+	const uint64_t* Data() const
+	{
+		return pWords;
+	}
+	T At( const Vei2& pos ) const
+	{
+		return At( pos.x,pos.y );
+	}
+	T At( int x,int y ) const
+	{
+		assert( Contains( x,y ) );
+		const auto word = pWords[(size_t)y * wordsPerRow + x / cellsPerWord];
+		return T( (word >> (x % cellsPerWord * bitsPerCell)) & mask );
+	}
+	void Set( const Vei2& pos,const T& val )
+	{
+		Set( pos.x,pos.y,val );
+	}
+	void Set( int x,int y,const T& val )
+	{
+		assert( Contains( x,y ) );
+		assert( (uint64_t)val <= mask );
+		assert( !owner && "views are read-only" );
+		auto& word = words[(size_t)y * wordsPerRow + x / cellsPerWord];
+		const int shift = x % cellsPerWord * bitsPerCell;
+		word = (word & ~(mask << shift)) | ((uint64_t)val << shift);
+	}
+	bool Contains( const Vei2& pos ) const
+	{
+		return Contains( pos.x,pos.y );
+	}
+	bool Contains( int x,int y ) const
+	{
+		return
+			x >= 0 &&
+			x < width &&
+			y >= 0 &&
+			y < height;
+	}
+private:
+	static constexpr uint64_t mask = (uint64_t( 1 ) << bitsPerCell) - 1u;
+private:
+	// val repeated in every cell of a word
+	static uint64_t Fill( const T& val )
+	{
+		uint64_t word = 0u;
+		for( int i = 0; i < cellsPerWord; i++ )
+		{
+			word |= (uint64_t)val << (i * bitsPerCell);
+		}
+		return word;
+	}
+private:
+	int width = 0;
+	int height = 0;
+	int wordsPerRow = 0;
+	std::vector<uint64_t> words;
+	const uint64_t* pWords = nullptr;
+	std::shared_ptr<const void> owner;
 };
 
 class TileMap
@@ -228,32 +730,31 @@ public:
 		Invalid
 	};
 public:
-	//RVDWprivate:
-	struct Tile
-	{
-		Tile() = default;
-		Tile( TileType type )
-			:
-			type( type ),
-			c( 0,0,0,0 )
-		{}
-		TileType type = TileType::Invalid;
-		Color c;
-	};
+	// largest supported map side, the ais size their virtual fields from this
+	static constexpr int maxSideLength = 16384;
 public:
+	// text map (#/./%), or a binary .rmz map which is mapped instead of read
+	// (sd is only used if the .rmz header has no start direction)
 	TileMap( const std::string& filename,const class Direction& sd );
+	// map over tiles that already exist (e.g. a view into a corpus archive)
+	TileMap( PackedGrid<TileType> tiles,const Vei2& startPos,const Direction& startDir )
+		:
+		tiles( std::move( tiles ) ),
+		start_pos( startPos ),
+		start_dir( startDir )
+	{}
 	// procedurally generated map
 	TileMap( const class Config& config,std::mt19937& rng );
-	const TileType& At( const Vei2& pos ) const
+	TileType At( const Vei2& pos ) const
 	{
-		return tiles.At( pos ).type;
-	}
-	TileType& At( const Vei2& pos )
-	{
-		return tiles.At( pos ).type;
+		return tiles.At( pos );
 	}
+#ifndef ROBOMAZE_HEADLESS
 	void Draw( Graphics& gfx,const Camera& cam,const Viewport& port ) const
 	{
+		const auto& sprites = GetSprites();
+		const int tileWidth = sprites.tileWidth;
+		const int tileHeight = sprites.tileHeight;
 		// establish grid looping extents
 		const RectI viewRect = (RectI)cam.GetViewingRect();
 		const int x_start = viewRect.left / tileWidth;
@@ -272,24 +773,23 @@ public:
 			{
 				int screen_x = x * tileWidth + translation.x;
 				int screen_y = y * tileHeight + translation.y;
-				auto& tile = tiles.At( { x,y } );
-				const auto tileType = tile.type;
+				const auto tileType = tiles.At( { x,y } );
 				if( tileType == TileType::Floor )
 				{
-					gfx.DrawSprite( screen_x,screen_y,pFloorSurf->GetRect(),
-						port.GetClipRect(),*pFloorSurf,SpriteEffect::Copy{}
+					gfx.DrawSprite( screen_x,screen_y,sprites.floor.GetRect(),
+						port.GetClipRect(),sprites.floor,SpriteEffect::Copy{}
 					);
 				}
 				else if( tileType == TileType::Wall )
 				{
-					gfx.DrawSprite( screen_x,screen_y,pWallSurf->GetRect(),
-						port.GetClipRect(),*pWallSurf,SpriteEffect::Copy{}
+					gfx.DrawSprite( screen_x,screen_y,sprites.wall.GetRect(),
+						port.GetClipRect(),sprites.wall,SpriteEffect::Copy{}
 					);
 				}
 				else if( tileType == TileType::Goal )
 				{
-					gfx.DrawSprite( screen_x,screen_y,pGoalSurf->GetRect(),
-						port.GetClipRect(),*pGoalSurf,SpriteEffect::Copy{}
+					gfx.DrawSprite( screen_x,screen_y,sprites.goal.GetRect(),
+						port.GetClipRect(),sprites.goal,SpriteEffect::Copy{}
 					);
 				}
 				else
@@ -297,73 +797,115 @@ public:
 					assert( "Bad tile type" && false );
 				}
 				// check if color is visible
-				if( tile.c.GetA() != 0u )
+				if( HasColorLayer() && colors.At( x,y ).GetA() != 0u )
 				{
 					gfx.DrawRect( 
 						{ { screen_x,screen_y },tileWidth,tileHeight },
-						tile.c,
+						colors.At( x,y ),
 						clipRect
 					);					
 				}
 			}
 		}
 	}
-	void Save( const std::string& filename ) const
+#endif
+	// binary .rmz map, the start direction is only stored if storeStartDir is set
+	void SaveBinary( const std::string& filename,bool storeStartDir = false ) const;
+	static bool IsBinaryMapFile( const std::string& filename );
+	const PackedGrid<TileType>& GetTiles() const
 	{
-		std::ofstream file( filename );
-		file << tiles.GetWidth() << " " << tiles.GetHeight() << std::endl;
-		file << start_pos.x << " " << start_pos.y << std::endl;
-
-		for( Vei2 pos = { 0,0 }; pos.y < tiles.GetHeight(); pos.y++ )
+		return tiles;
+	}
+	// fnv-1a of the dimensions, start pos and tiles (not the start direction),
+	// the same for a map whether it was loaded from text or .rmz
+	uint64_t GetContentHash() const;
+	// text map, built in memory and written with a single write
+	// rle writes runs of a tile as <count><tile> (e.g. 40#), which the loader also reads
+	void Save( const std::string& filename,bool rle = false ) const
+	{
+		const auto text = ToText( rle );
+		std::ofstream file( filename,std::ios::binary );
+		file.write( text.data(),(std::streamsize)text.size() );
+	}
+	std::string ToText( bool rle = false ) const
+	{
+		const char glyphs[] = { '#','.','%','?' };
+		std::string text = std::to_string( tiles.GetWidth() ) + " " + std::to_string( tiles.GetHeight() ) + "\n" +
+			std::to_string( start_pos.x ) + " " + std::to_string( start_pos.y ) + "\n";
+		text.reserve( text.size() + ((size_t)tiles.GetWidth() + 1u) * tiles.GetHeight() );
+		for( int y = 0; y < tiles.GetHeight(); y++ )
 		{
-			for( pos.x = 0; pos.x < tiles.GetWidth(); pos.x++ )
+			for( int x = 0; x < tiles.GetWidth(); )
 			{
-				switch( tiles.At( pos ).type )
+				const auto type = tiles.At( x,y );
+				int n = 1;
+				while( rle && x + n < tiles.GetWidth() && tiles.At( x + n,y ) == type )
 				{
-				case TileType::Floor:
-					file << ".";
-					break;
-				case TileType::Wall:
-					file << "#";
-					break;
-				case TileType::Goal:
-					file << "%";
-					break;
-				case TileType::Invalid:
-					file << "?";
-					break;
+					n++;
 				}
+				if( n > 1 )
+				{
+					text += std::to_string( n );
+				}
+				text += glyphs[(int)type];
+				x += n;
 			}
-			if( pos.y != tiles.GetHeight() - 1 )
+			if( y != tiles.GetHeight() - 1 )
 			{
-				file << std::endl;
+				text += '\n';
 			}
 		}
+		return text;
 	}
 	Direction GetStartDirection() const
 	{
 		return start_dir;
 	}
+#ifndef ROBOMAZE_HEADLESS
 	RectI GetMapBounds() const
 	{
-		return{ 0,tiles.GetWidth()*tileWidth,0,tiles.GetHeight()*tileHeight };
+		const auto& sprites = GetSprites();
+		return{ 0,tiles.GetWidth()*sprites.tileWidth,0,tiles.GetHeight()*sprites.tileHeight };
 	}
 	Vei2 GetCenterAt( const Vei2& pos ) const
 	{
 		assert( Contains( pos ) );
-		return{ pos.x * tileWidth + tileWidth / 2,pos.y * tileHeight + tileHeight / 2 };
+		const auto& sprites = GetSprites();
+		return{ 
+			pos.x * sprites.tileWidth + sprites.tileWidth / 2,
+			pos.y * sprites.tileHeight + sprites.tileHeight / 2
+		};
 	}
+#endif
 	bool Contains( const Vei2& pos ) const
 	{
 		return tiles.Contains( pos );
 	}
+	// debug color overlay, only allocated for simulators that draw marks
+	// (call before anything reads it from another thread); dense on purpose, the
+	// debug ais mark from their own thread without the gfx lock while Draw reads,
+	// which a grid allocated up front survives (at worst a stale color) but pages
+	// allocated on first write would not
+	void EnableColorLayer()
+	{
+		if( !HasColorLayer() )
+		{
+			colors = Grid<Color>( tiles.GetWidth(),tiles.GetHeight(),Color( 0,0,0,0 ) );
+		}
+	}
+	bool HasColorLayer() const
+	{
+		return colors.GetWidth() == tiles.GetWidth();
+	}
 	Color GetColorAt( const Vei2& pos ) const
 	{
-		return tiles.At( pos ).c;
+		assert( Contains( pos ) );
+		return HasColorLayer() ? colors.At( pos ) : Color( 0,0,0,0 );
 	}
 	void SetColorAt( const Vei2& pos,Color color )
 	{
-		tiles.At( pos ).c = color;
+		assert( HasColorLayer() );
+		colors.At( pos ) = color;
 	}
 	int GetGridWidth() const
 	{
@@ -380,10 +922,9 @@ public:
 	template<typename F>
 	void VisitNeighbors( const Vei2& pos,F f )
 	{
-		auto dir = Direction::Up();
-		for( int i = 0; i < 4; i++,dir.RotateClockwise() )
+		for( int i = 0; i < 4; i++ )
 		{
-			const auto p = pos + dir;
+			const Vei2 p = { pos.x + neighborDx[i],pos.y + neighborDy[i] };
 			if( Contains( p ) )
 			{
 				f( p );
@@ -391,12 +932,45 @@ public:
 		}
 	}
 private:
-	std::unique_ptr<Surface> pFloorSurf;
-	std::unique_ptr<Surface> pWallSurf;
-	std::unique_ptr<Surface> pGoalSurf;
-	int tileWidth;
-	int tileHeight;
-	Grid<Tile> tiles;
+	void Generate( const class Config& config,std::mt19937& rng,Grid<TileType>& tiles );
+	// rooms, corridors and doors inside tiles' border (startPos is only set for the in view goal room)
+	void GenerateCompartments( const class Config& config,int nRoomTries,bool placeGoalRoom,
+		std::mt19937& rng,Grid<TileType>& tiles,Vei2& startPos ) const;
+	void GenerateRegions( const class Config& config,std::mt19937& rng,Grid<TileType>& tiles );
+	void LoadText( const std::string& filename );
+	void LoadBinary( const std::string& filename );
+#ifndef ROBOMAZE_HEADLESS
+	// tile sprites are shared by every map and only loaded once something is drawn
+	struct Sprites
+	{
+		Sprites()
+			:
+			floor( Assets::GetSurface( "Images/floor.bmp" ) ),
+			wall( Assets::GetSurface( "Images/wall.bmp" ) ),
+			goal( Assets::GetSurface( "Images/goal.bmp" ) ),
+			tileWidth( floor.GetWidth() ),
+			tileHeight( floor.GetHeight() )
+		{
+			assert( tileWidth == wall.GetWidth() );
+			assert( tileHeight == wall.GetHeight() );
+			assert( tileWidth == goal.GetWidth() );
+			assert( tileHeight == goal.GetHeight() );
+		}
+		const Surface& floor;
+		const Surface& wall;
+		const Surface& goal;
+		int tileWidth;
+		int tileHeight;
+	};
+	static const Sprites& GetSprites()
+	{
+		static const Sprites sprites;
+		return sprites;
+	}
+#endif
+	PackedGrid<TileType> tiles;
+	// empty unless EnableColorLayer() was called
+	Grid<Color> colors;
 	Vei2 start_pos;
 	Direction start_dir;
 };
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#if defined( _MSC_VER ) && (defined( _M_X64 ) || defined( _M_IX86 ))
+#include <intrin.h>
+#define ROBOMAZE_HAS_TSC
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define ROBOMAZE_HAS_TSC
+#endif
+
+// cheap timestamp for instrumenting hot calls
+// reads the cpu time stamp counter where available (a few ns, no syscall)
+// and falls back to steady_clock nanoseconds elsewhere
+class TscClock
+{
+public:
+	static uint64_t Now()
+	{
+#ifdef ROBOMAZE_HAS_TSC
+		return __rdtsc();
+#else
+		using namespace std::chrono;
+		return (uint64_t)duration_cast<nanoseconds>( steady_clock::now().time_since_epoch() ).count();
+#endif
+	}
+	// calibrated once per process against steady_clock
+	static double GetSecondsPerTick()
+	{
+		static const double secondsPerTick = Calibrate();
+		return secondsPerTick;
+	}
+	static double ToSeconds( uint64_t ticks )
+	{
+		return (double)ticks * GetSecondsPerTick();
+	}
+private:
+	static double Calibrate()
+	{
+#ifdef ROBOMAZE_HAS_TSC
+		using namespace std::chrono;
+		const auto t0 = steady_clock::now();
+		const auto c0 = Now();
+		std::this_thread::sleep_for( milliseconds( 20 ) );
+		const auto c1 = Now();
+		const duration<double> elapsed = steady_clock::now() - t0;
+		return elapsed.count() / (double)(c1 - c0);
+#else
+		return 1e-9;
+#endif
+	}
+};